@@ -6,10 +6,21 @@
 #include "compiler.h"
 #include <string>
 
+/* Optimization level: `-O0 ... -Oz` on the command line, or `#optimize`
+ * per file (stored in ASTNode::node_opt) */
+enum OptLevel { OPT_O0, OPT_O1, OPT_O2, OPT_O3, OPT_OS, OPT_OZ };
+
+/* `cpu` is the --cpu value: nullptr/"generic", "native", or an x86-64
+ * psABI level ("x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4").
+ * `report_tailcalls` (--report-tailcalls) prints the `return f(...)`
+ * sites that could not become guaranteed tail calls, and why. */
 bool llvm_codegen_compile(ASTNode* program, CompileMode mode,
                           const char* source_path,
                           const std::string& outputObj,
-                          bool autofree, bool allow_leaks);
+                          bool autofree, bool allow_leaks,
+                          const char* cpu = nullptr,
+                          OptLevel opt_level = OPT_O2,
+                          bool report_tailcalls = false);
 
 bool llvm_codegen_link(const std::string& objPath,
                        const std::string& exePath);
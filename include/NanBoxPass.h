@@ -0,0 +1,17 @@
+/*  NanBoxPass.h  —  LLVM pass that removes NaN-box round-trips */
+#ifndef TANTRUMS_NANBOX_PASS_H
+#define TANTRUMS_NANBOX_PASS_H
+
+#include <llvm/IR/PassManager.h>
+
+/* Function pass run from the optimizer's peephole extension point, i.e.
+ * after the runtime bitcode has been inlined into generated code.  It
+ * folds tag tests on values whose tag is already known (through PHIs and
+ * loop-carried values), drops redundant 48-bit sign-extensions, unboxes
+ * tagged PHI webs, and removes float NaN-canonicalization that is
+ * immediately undone by an unbox. */
+struct NanBoxPass : llvm::PassInfoMixin<NanBoxPass> {
+    llvm::PreservedAnalyses run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM);
+};
+
+#endif /* TANTRUMS_NANBOX_PASS_H */
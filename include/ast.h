@@ -33,6 +33,7 @@ struct ASTNode {
     int      node_mode;        /* -1 = inherit, else CompileMode value */
     int      node_autofree;    /* -1 = inherit, 0 = false, 1 = true   */
     int      node_allow_leaks; /* -1 = inherit, 0 = false, 1 = true   */
+    int      node_opt;         /* -1 = inherit, else OptLevel value   */
     union {
         int64_t int_literal;                                          /* INT_LIT   */
         double  float_literal;                                        /* FLOAT_LIT */
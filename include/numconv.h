@@ -0,0 +1,23 @@
+/*  numconv.h  —  Number <-> text conversion shared by the runtime */
+#ifndef TANTRUMS_NUMCONV_H
+#define TANTRUMS_NUMCONV_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Byte-for-byte what the printf/strto* calls they replace produce in
+ * the C locale, without going through stdio or the locale for ordinary
+ * values.  Formatters write a NUL-terminated string and return its
+ * length; `buf` needs NUM_BUF_SIZE bytes (print() output of huge floats
+ * is cut at NUM_BUF_SIZE - 1 chars, as it always was). */
+#define NUM_BUF_SIZE 64
+
+int     num_format_int(int64_t v, char* buf);        /* "%lld"                        */
+int     num_format_print(double d, char* buf);       /* print(): "%.10f", trailing
+                                                        zeros trimmed to one          */
+int     num_format_general(double d, char* buf);     /* "%g"                          */
+
+int64_t num_parse_int(const char* s);                /* strtoll(s, nullptr, 10)       */
+double  num_parse_float(const char* s);              /* strtod(s, nullptr)            */
+
+#endif
@@ -75,10 +75,21 @@ extern "C" {
 
 /* ── Output ─────────────────────────────────────────── */
 void            rt_print(TantrumsValue* args, int32_t count);
+/* Pieces of a lowered print(): literal text (separators and the newline
+ * included), raw numbers, and anything else by dynamic type */
+void            rt_print_str(const char* chars, int32_t length);
+void            rt_print_int(int64_t v);
+void            rt_print_f64(double v);
+void            rt_print_val(TantrumsValue v);
 
 /* ── Strings ────────────────────────────────────────── */
 TantrumsValue   rt_string_from_cstr(const char* s);
+/* A flattened `a + b + ...` that is string concatenation: joins all parts
+ * (formatted as rt_add would) into one string allocated once */
+TantrumsValue   rt_concat(TantrumsValue* parts, int32_t count);
 TantrumsValue   rt_input(TantrumsValue prompt);
+int64_t         rt_string_hash(TantrumsValue v);
+int32_t         rt_string_equals(TantrumsValue v, const char* chars, int32_t length);
 
 /* ── Collections ────────────────────────────────────── */
 TantrumsValue   rt_len(TantrumsValue v);
@@ -86,8 +97,16 @@ TantrumsValue   rt_range(TantrumsValue a, TantrumsValue b, TantrumsValue c);
 TantrumsValue   rt_type(TantrumsValue v);
 TantrumsValue   rt_list_new(TantrumsValue* items, int32_t count);
 TantrumsValue   rt_map_new(TantrumsValue* keys, TantrumsValue* vals, int32_t count);
+TantrumsValue   rt_map_new_shaped(struct Shape** site, TantrumsValue* keys, TantrumsValue* vals, int32_t count);
 TantrumsValue   rt_index_get(TantrumsValue obj, TantrumsValue idx);
 void            rt_index_set(TantrumsValue obj, TantrumsValue idx, TantrumsValue val);
+
+/* Per-site monomorphic inline cache for obj.field: the last shape seen
+ * and the key's slot in it (-1 = not in the shape).  Zero-initialized
+ * by the compiler. */
+typedef struct { struct Shape* shape; int32_t slot; } RtFieldCache;
+TantrumsValue   rt_field_get(TantrumsValue obj, struct ObjString* key, int32_t hash, RtFieldCache* ic);
+void            rt_field_set(TantrumsValue obj, struct ObjString* key, int32_t hash, RtFieldCache* ic, TantrumsValue val);
 void            rt_append(TantrumsValue list, TantrumsValue val);
 
 /* ── Memory / Pointers ──────────────────────────────── */
@@ -120,6 +139,21 @@ int32_t         rt_is_truthy(TantrumsValue v);
 TantrumsValue   rt_for_in_step(TantrumsValue iterable, int64_t* counter);
 int32_t         rt_for_in_has_next(TantrumsValue iterable, int64_t idx);
 
+/* Specialized for-in (caller dispatches on rt_for_in_kind once per loop) */
+#define RT_FOR_IN_GENERIC 0
+#define RT_FOR_IN_LIST    1
+#define RT_FOR_IN_STRING  2
+int32_t         rt_for_in_kind(TantrumsValue iterable);
+int64_t         rt_list_count(TantrumsValue list);
+TantrumsValue   rt_list_item(TantrumsValue list, int64_t idx);
+/* Element access once the caller has checked the container type (and,
+ * for lists, the index) */
+void            rt_list_store(TantrumsValue list, int64_t idx, TantrumsValue val);
+TantrumsValue   rt_map_get(TantrumsValue map, TantrumsValue key);
+void            rt_map_set(TantrumsValue map, TantrumsValue key, TantrumsValue val);
+int64_t         rt_string_length(TantrumsValue str);
+TantrumsValue   rt_string_char(TantrumsValue str, int64_t idx);
+
 /* ── Error handling ─────────────────────────────────── */
 void            rt_throw(TantrumsValue val);
 void            rt_try_push(void);   /* increment try_depth after _setjmp()==0 */
@@ -135,6 +169,12 @@ void            rt_enter_scope(void);
 void            rt_exit_scope(void);
 void            rt_mark_escaped(TantrumsValue v);
 void            rt_free_collection(TantrumsValue v);
+/* Locals that never leave their scope, built in entry-block storage of
+ * the size the compiler computes from value.h; see obj_list_new_local */
+TantrumsValue   rt_alloc_local(void* mem, TantrumsValue init);
+TantrumsValue   rt_list_new_local(void* mem, TantrumsValue* items, int32_t count);
+TantrumsValue   rt_map_new_local(void* mem, struct Shape** site, TantrumsValue* keys, TantrumsValue* vals, int32_t count);
+void            rt_local_release(void* mem);
 
 /* ── Lifecycle ──────────────────────────────────────── */
 void            rt_set_exe_path(const char* argv0);
@@ -160,4 +200,84 @@ TantrumsValue   rt_bytesToGB(TantrumsValue bytes);
 }
 #endif
 
+/* ── Effects promised to the optimizer ──────────────── */
+/*  The LLVM backend puts these on every runtime declaration and call
+ *  site.  A function that can raise a runtime error (longjmp into a
+ *  try, or rt_fatal_error) must not be RT_NOTHROW, and RT_READONLY /
+ *  RT_READNONE are only valid together with RT_NOTHROW.  Functions not
+ *  listed get no attributes.  Keep in sync when a definition changes. */
+#define RT_NOTHROW    0x01   /* never longjmps or exits: nounwind willreturn */
+#define RT_READONLY   0x02   /* does not write memory                       */
+#define RT_READNONE   0x04   /* does not touch memory at all                */
+#define RT_NOCAPTURE  0x08   /* pointer arguments are not retained          */
+#define RT_COLD       0x10   /* error path only: cold noreturn              */
+
+#define RT_EFFECTS(X)                                              \
+    X(rt_print,              RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_print_str,          RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_print_int,          RT_NOTHROW)                           \
+    X(rt_print_f64,          RT_NOTHROW)                           \
+    X(rt_print_val,          RT_NOTHROW)                           \
+    X(rt_string_from_cstr,   RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_concat,             RT_NOCAPTURE)                         \
+    X(rt_string_hash,        RT_NOTHROW | RT_READONLY)             \
+    X(rt_string_equals,      RT_NOTHROW | RT_READONLY | RT_NOCAPTURE) \
+    X(rt_len,                RT_NOTHROW | RT_READONLY)             \
+    X(rt_type,               RT_NOTHROW)                           \
+    X(rt_list_new,           RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_map_new,            RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_map_new_shaped,     RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_field_get,          RT_NOCAPTURE)                         \
+    X(rt_alloc,              RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_eq,                 RT_NOTHROW | RT_READONLY)             \
+    X(rt_neq,                RT_NOTHROW | RT_READONLY)             \
+    X(rt_for_in_step,        RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_for_in_has_next,    RT_NOTHROW | RT_READONLY)             \
+    X(rt_for_in_kind,        RT_NOTHROW | RT_READONLY)             \
+    X(rt_list_count,         RT_NOTHROW | RT_READONLY)             \
+    X(rt_list_item,          RT_NOTHROW | RT_READONLY)             \
+    X(rt_list_store,         RT_NOTHROW)                           \
+    X(rt_map_get,            RT_NOTHROW | RT_READONLY)             \
+    X(rt_map_set,            RT_NOTHROW)                           \
+    X(rt_string_length,      RT_NOTHROW | RT_READONLY)             \
+    X(rt_string_char,        RT_NOTHROW)                           \
+    X(rt_throw,              RT_COLD)                              \
+    X(rt_try_push,           RT_NOTHROW)                           \
+    X(rt_try_exit,           RT_NOTHROW)                           \
+    X(rt_caught_val,         RT_NOTHROW | RT_READONLY)             \
+    X(rt_enter_scope,        RT_NOTHROW)                           \
+    X(rt_exit_scope,         RT_NOTHROW)                           \
+    X(rt_mark_escaped,       RT_NOTHROW)                           \
+    X(rt_free_collection,    RT_NOTHROW)                           \
+    X(rt_alloc_local,        RT_NOTHROW)                           \
+    X(rt_list_new_local,     RT_NOTHROW)                           \
+    X(rt_map_new_local,      RT_NOTHROW)                           \
+    X(rt_local_release,      RT_NOTHROW)                           \
+    X(rt_set_exe_path,       RT_NOTHROW | RT_NOCAPTURE)            \
+    X(rt_getCurrentTime,     RT_NOTHROW)                           \
+    X(rt_toSeconds,          RT_NOTHROW | RT_READNONE)             \
+    X(rt_toMilliseconds,     RT_NOTHROW | RT_READNONE)             \
+    X(rt_toMinutes,          RT_NOTHROW | RT_READNONE)             \
+    X(rt_toHours,            RT_NOTHROW | RT_READNONE)             \
+    X(rt_getProcessMemory,   RT_NOTHROW)                           \
+    X(rt_getHeapMemory,      RT_NOTHROW | RT_READONLY)             \
+    X(rt_getHeapPeakMemory,  RT_NOTHROW | RT_READONLY)             \
+    X(rt_bytesToKB,          RT_NOTHROW | RT_READNONE)             \
+    X(rt_bytesToMB,          RT_NOTHROW | RT_READNONE)             \
+    X(rt_bytesToGB,          RT_NOTHROW | RT_READNONE)             \
+    /* stdlib/maths.cpp: libm may set errno, so only floor/ceil are pure */ \
+    X(rt_math_sin,           RT_NOTHROW)                           \
+    X(rt_math_cos,           RT_NOTHROW)                           \
+    X(rt_math_tan,           RT_NOTHROW)                           \
+    X(rt_math_sec,           RT_NOTHROW)                           \
+    X(rt_math_cosec,         RT_NOTHROW)                           \
+    X(rt_math_cot,           RT_NOTHROW)                           \
+    X(rt_math_floor,         RT_NOTHROW | RT_READNONE)             \
+    X(rt_math_ceil,          RT_NOTHROW | RT_READNONE)             \
+    X(rt_math_random_int,    RT_NOTHROW)                           \
+    X(rt_math_random_float,  RT_NOTHROW)                           \
+    X(rt_math_sqrt,          RT_NOTHROW)                           \
+    X(rt_math_pow,           RT_NOTHROW)                           \
+    X(rt_math_cbrt,          RT_NOTHROW)
+
 #endif /* TANTRUMS_RUNTIME_H */
@@ -11,6 +11,8 @@ typedef struct ObjFunction ObjFunction;
 typedef struct ObjNative ObjNative;
 typedef struct ObjPointer ObjPointer;
 typedef struct ObjRange ObjRange;
+typedef struct ObjArray ObjArray;
+typedef struct Shape Shape;
 typedef struct Chunk Chunk;
 typedef struct VM VM;
 
@@ -29,20 +31,38 @@ static inline Value OBJ_VAL(void* o)    { Value r; r.type = VAL_OBJ;   r.as.obj
 static inline Value NULL_VAL_MAKE()     { Value r; r.type = VAL_NULL;  r.as.integer  = 0; return r; }
 #define NULL_VAL NULL_VAL_MAKE()
 
-typedef enum { OBJ_STRING, OBJ_LIST, OBJ_MAP, OBJ_FUNCTION, OBJ_NATIVE, OBJ_POINTER, OBJ_RANGE } ObjType;
+typedef enum { OBJ_STRING, OBJ_LIST, OBJ_MAP, OBJ_FUNCTION, OBJ_NATIVE, OBJ_POINTER, OBJ_RANGE, OBJ_ARRAY } ObjType;
 
 struct Obj        { ObjType type; int refcount; bool is_manual; bool is_marked; Obj* next; };
 struct ObjString  { Obj obj; int length; int capacity; bool is_mutable; char* chars; uint32_t hash; };
-struct ObjList    { Obj obj; Value* items; int count; int capacity; bool escaped; int scope_depth; bool auto_manage; };
+/* A list stores its elements in the narrowest form that fits everything
+ * stored so far: raw int64_t, raw double, packed bits, or boxed Values.
+ * The first store that doesn't fit generalizes the list to LIST_VALUES for
+ * good.  Read and write elements through obj_list_get/obj_list_put.
+ * Compiled code reads int/float lists inline, so the field order is
+ * mirrored by the ObjList struct in LLVMCodegen.cpp.  A `local` list lives
+ * in storage owned by compiled code (see obj_list_new_local). */
+typedef enum { LIST_EMPTY, LIST_INTS, LIST_FLOATS, LIST_BOOLS, LIST_VALUES } ListStorage;
+struct ObjList    { Obj obj; void* items; int count; int capacity; bool escaped; int scope_depth; bool auto_manage; ListStorage storage; bool local; };
 
 typedef struct { Value key; Value value; bool occupied; } MapEntry;
-struct ObjMap     { Obj obj; MapEntry* entries; int count; int capacity; bool escaped; int scope_depth; bool auto_manage; };
+/* Key layout shared by every map built from the same literal key list.
+ * A shaped map keeps its values in a dense `slots` array (entries stays
+ * null) until a key outside the shape is added.  iter_order lists slots
+ * in the order the equivalent hashed table would iterate them.  Shapes
+ * are interned and live for the whole run. */
+struct Shape      { int count; ObjString** keys; int* iter_order; Shape* next; };
+struct ObjMap     { Obj obj; MapEntry* entries; int count; int capacity; bool escaped; int scope_depth; bool auto_manage; Shape* shape; Value* slots; bool local; };
 
 typedef Value (*NativeFn)(VM* vm, int arg_count, Value* args);
 struct ObjNative  { Obj obj; NativeFn function; const char* name; };
 struct ObjFunction{ Obj obj; int arity; Chunk* chunk; ObjString* name; };
 struct ObjPointer { Obj obj; Value* target; bool is_valid; size_t alloc_size; int alloc_line; ObjString* alloc_type; ObjString* alloc_func; int scope_depth; bool escaped; bool auto_manage; };
 struct ObjRange { Obj obj; int64_t start; int64_t end; int64_t step; int64_t length; };
+/* Typed array (int[] / float[]): `count` unboxed int64_t or double
+ * elements, contiguous in `data`.  Compiled code indexes it inline, so
+ * the field order is mirrored by the ObjArray struct in LLVMCodegen.cpp. */
+struct ObjArray { Obj obj; void* data; int64_t count; int64_t capacity; bool is_float; };
 
 #define IS_INT(v)      ((v).type == VAL_INT)
 #define IS_FLOAT(v)    ((v).type == VAL_FLOAT)
@@ -57,6 +77,7 @@ struct ObjRange { Obj obj; int64_t start; int64_t end; int64_t step; int64_t len
 #define IS_NATIVE(v)   (IS_OBJ(v) && OBJ_TYPE(v) == OBJ_NATIVE)
 #define IS_POINTER(v)  (IS_OBJ(v) && OBJ_TYPE(v) == OBJ_POINTER)
 #define IS_RANGE(v)    (IS_OBJ(v) && OBJ_TYPE(v) == OBJ_RANGE)
+#define IS_ARRAY(v)    (IS_OBJ(v) && OBJ_TYPE(v) == OBJ_ARRAY)
 
 #define AS_INT(v)      ((v).as.integer)
 #define AS_FLOAT(v)    ((v).as.floating)
@@ -70,22 +91,48 @@ struct ObjRange { Obj obj; int64_t start; int64_t end; int64_t step; int64_t len
 #define AS_NATIVE(v)   ((ObjNative*)AS_OBJ(v))
 #define AS_POINTER(v)  ((ObjPointer*)AS_OBJ(v))
 #define AS_RANGE(v)    ((ObjRange*)AS_OBJ(v))
+#define AS_ARRAY(v)    ((ObjArray*)AS_OBJ(v))
 
 double       value_as_number(Value v);
 ObjString*   obj_string_new(const char* chars, int length);
 ObjString*   obj_string_clone_mutable(ObjString* a);
+/* Mutable string of `length` unset chars (NUL-terminated); the caller
+ * fills them in and sets the hash */
+ObjString*   obj_string_alloc(int length);
 void         obj_string_append(ObjString* a, const char* chars, int length);
 ObjString*   obj_string_concat(ObjString* a, ObjString* b);
 ObjList*     obj_list_new(void);
 ObjList*     obj_list_clone(ObjList* origin);
 void         obj_list_append(ObjList* list, Value value);
+void         obj_list_extend(ObjList* list, ObjList* src);
+Value        obj_list_get(ObjList* list, int index);
+void         obj_list_put(ObjList* list, int index, Value value);
 ObjMap*      obj_map_new(void);
 bool         obj_map_set(ObjMap* map, Value key, Value value);
 bool         obj_map_get(ObjMap* map, Value key, Value* out);
+bool         obj_map_set_str(ObjMap* map, ObjString* key, uint32_t hash, Value value);
+bool         obj_map_get_str(ObjMap* map, ObjString* key, uint32_t hash, Value* out);
+Shape*       shape_intern(ObjString** keys, int count);
+int          shape_slot(Shape* shape, ObjString* key, uint32_t hash);
+ObjMap*      obj_map_new_shaped(Shape* shape);
 ObjFunction* obj_function_new(void);
 ObjNative*   obj_native_new(NativeFn fn, const char* name);
 ObjPointer*  obj_pointer_new(Value* target);
+/* Objects built in caller-owned memory, for locals the compiler proved
+ * never leave their scope.  They are not linked into all_objects, so scope
+ * tracking, leak reports and shutdown never see them; the owner calls
+ * obj_local_release before the memory goes away.  A list keeps `capacity`
+ * Values' worth of items, and a shaped map its slots, inline behind the
+ * header, and moves them to the heap if it outgrows them. */
+ObjList*     obj_list_new_local(void* mem, int capacity);
+ObjMap*      obj_map_new_local(void* mem, Shape* shape);
+ObjPointer*  obj_pointer_new_local(void* mem);
+void         obj_local_release(Obj* obj);
 ObjRange*    obj_range_new(int64_t start, int64_t end, int64_t step);
+ObjArray*    obj_array_new(bool is_float, int64_t capacity);
+void         obj_array_push(ObjArray* array, Value value);
+Value        obj_array_get(ObjArray* array, int64_t index);
+void         obj_array_put(ObjArray* array, int64_t index, Value value);
 void         value_incref(Value v);
 void         value_decref(Value v);
 void         obj_free(Obj* obj);
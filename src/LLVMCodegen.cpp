@@ -8,19 +8,23 @@
  *  All LLVM types are fully qualified with the llvm:: prefix.
  */
 #include "LLVMCodegen.h"
+#include "NanBoxPass.h"
 #include "runtime.h"
 #include "token.h"
 #include "compiler.h"
+#include "numconv.h"
 
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/MC/TargetRegistry.h>
@@ -31,11 +35,17 @@
 #include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Linker/Linker.h>
 #include "tantrums_runtime_bc.h"
+#ifdef TANTRUMS_RUNTIME_ISA_LEVELS
+#include "tantrums_runtime_bc_v2.h"
+#include "tantrums_runtime_bc_v3.h"
+#include "tantrums_runtime_bc_v4.h"
+#endif
 
 /* On Windows we invoke lld-link.exe as an external process
  * to avoid pulling in LLVMWindowsManifest/libxml2 dependencies. */
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -51,9 +61,18 @@ struct LoopInfo {
     llvm::BasicBlock* cont_tgt;
 };
 
+/* How a local's alloca holds its value.  Typed int/float locals in
+ * static/both mode live unboxed; everything else is a NaN-boxed i64.
+ * SLOT_BOOL (raw i1) only appears in native function signatures. */
+enum SlotKind { SLOT_BOXED, SLOT_INT, SLOT_FLOAT, SLOT_BOOL };
+
 struct FuncSigInfo {
     std::string ret_type;
     int param_count;
+    /* Fully typed functions get a raw-typed body; `native` is null otherwise */
+    llvm::Function* native = nullptr;
+    std::vector<SlotKind> param_kinds;
+    SlotKind ret_kind = SLOT_BOXED;
 };
 
 struct LocalInfo {
@@ -63,6 +82,10 @@ struct LocalInfo {
     bool holds_alloc;
     bool auto_free;
     bool auto_free_collection;
+    /* Entry-block storage holding the object itself (llvm_local_storage_size);
+     * null for heap objects.  Collections release grown buffers at scope exit. */
+    llvm::Value* stack_obj;
+    bool stack_collection;
 };
 
 struct Codegen {
@@ -72,19 +95,26 @@ struct Codegen {
 
     llvm::Type* i64Ty;
     llvm::Type* i32Ty;
+    llvm::Type* f64Ty;
     llvm::Type* i8PtrTy;
     llvm::Type* voidTy;
 
     llvm::Function* curFunc = nullptr;
+    SlotKind curRetKind = SLOT_BOXED;   /* raw return type of a native body */
+    const char* curRetType = nullptr;   /* declared return type of the current function */
 
-    /* locals: name → alloca of i64 */
+    /* locals: name → alloca (i64 boxed, or raw i64/double per kindScopes) */
     std::vector<std::map<std::string, llvm::AllocaInst*>> scopes;
     std::vector<std::map<std::string, std::string>> typeScopes;
+    std::vector<std::map<std::string, SlotKind>> kindScopes;
 
     /* globals: name → GlobalVariable (i64) */
     std::map<std::string, llvm::GlobalVariable*> globals;
     std::map<std::string, std::string> globalTypes;
 
+    /* identifier reads → type proven by the flow pass (inferFlowTypes) */
+    std::map<const ASTNode*, const char*> flowTypes;
+
     /* user function map */
     std::map<std::string, llvm::Function*> userFuncs;
     std::map<std::string, FuncSigInfo> funcSigs;
@@ -92,24 +122,98 @@ struct Codegen {
     std::vector<LoopInfo> loopStack;
     CompileMode mode = MODE_BOTH;
 
+    /* `array[index]` pairs an enclosing range(len(array)) loop keeps in
+     * bounds (codegenRangeLoop).  A typed array's data pointer is loaded
+     * once before the loop; a list gets a per-loop list test instead. */
+    struct CheckedIndex { std::string array, index; llvm::Value* data; llvm::Value* isList; };
+    std::vector<CheckedIndex> checkedIndices;
+
     /* Memory safety state */
     bool autofree_enabled = true;
     bool allow_leaks_enabled = false;
     int scopeDepth = 0;
     std::vector<std::vector<LocalInfo>> localInfoScopes;
+    /* Set by NODE_BLOCK for the var_decl it is about to emit; the decl
+     * hands its storage to the matching literal/alloc via stackInit */
+    size_t pendingStorage = 0;
+    ASTNode* stackInit = nullptr;
+    llvm::Value* stackMem = nullptr;
+
+    /* Tail calls (emitTailCall): the function being emitted, whether its
+     * body allocates, and how many try bodies enclose the current point */
+    const char* curFuncName = nullptr;
+    bool curFuncAllocs = false;
+    int tryNesting = 0;
+    /* --report-tailcalls: `return f(...)` sites seen and those left as calls */
+    const char* sourcePath = nullptr;
+    bool reportTailCalls = false;
+    int tailCallSites = 0;
+    std::vector<std::string> tailCallMisses;
 
     /* try_stack / try_depth globals for setjmp */
     llvm::GlobalVariable* tryStackGV = nullptr;
     llvm::GlobalVariable* tryDepthGV = nullptr;
+
+    /* literal text → immortal ObjString (makeStaticString) */
+    std::map<std::string, llvm::GlobalVariable*> staticStrings;
+    llvm::StructType* objTy = nullptr;
+    llvm::StructType* objStringTy = nullptr;
+    llvm::StructType* objArrayTy = nullptr;
+    llvm::StructType* objListTy = nullptr;
+    llvm::StructType* fieldCacheTy = nullptr;
+
+    /* TBAA type nodes for what generated code touches directly.  They
+     * hang off their own root: against the runtime's C++ TBAA (inlined
+     * bitcode) LLVM stays conservative, but among themselves a list
+     * element store cannot clobber a script global or a list's count. */
+    enum TbaaTag {
+        TBAA_LOCAL, TBAA_GLOBAL, TBAA_OBJ_TYPE,
+        TBAA_LIST_ITEMS, TBAA_LIST_COUNT, TBAA_LIST_STORAGE, TBAA_LIST_ELEM,
+        TBAA_ARRAY_DATA, TBAA_ARRAY_COUNT, TBAA_ARRAY_ELEM,
+        TBAA_TAG_COUNT
+    };
+    llvm::MDNode* tbaaTags[TBAA_TAG_COUNT] = {};
     /* ── helpers ─────────────────────────────────────── */
 
-    llvm::AllocaInst* createEntryAlloca(llvm::Function* F, const std::string& name) {
+    template <class I> I* tbaa(I* inst, TbaaTag t) {
+        if (!tbaaTags[t]) {
+            static const char* const names[TBAA_TAG_COUNT] = {
+                "local slot", "script global", "Obj.type",
+                "ObjList.items", "ObjList.count", "ObjList.storage", "list element",
+                "ObjArray.data", "ObjArray.count", "array element",
+            };
+            llvm::MDBuilder md(ctx);
+            llvm::MDNode* root = md.createTBAARoot("Tantrums TBAA");
+            llvm::MDNode* ty = md.createTBAAScalarTypeNode(names[t], root);
+            tbaaTags[t] = md.createTBAAStructTagNode(ty, ty, 0);
+        }
+        inst->setMetadata(llvm::LLVMContext::MD_tbaa, tbaaTags[t]);
+        return inst;
+    }
+    /* Loads and stores of a variable's own slot (alloca or script global) */
+    llvm::LoadInst* loadSlot(llvm::Type* ty, llvm::Value* slot, const llvm::Twine& name = "") {
+        return tbaa(B->CreateLoad(ty, slot, name), llvm::isa<llvm::GlobalVariable>(slot) ? TBAA_GLOBAL : TBAA_LOCAL);
+    }
+    llvm::StoreInst* storeSlot(llvm::Value* v, llvm::Value* slot) {
+        return tbaa(B->CreateStore(v, slot), llvm::isa<llvm::GlobalVariable>(slot) ? TBAA_GLOBAL : TBAA_LOCAL);
+    }
+
+    llvm::AllocaInst* createEntryAlloca(llvm::Function* F, const std::string& name, llvm::Type* ty = nullptr) {
         llvm::IRBuilder<> tmpB(&F->getEntryBlock(), F->getEntryBlock().begin());
-        return tmpB.CreateAlloca(i64Ty, nullptr, name);
+        return tmpB.CreateAlloca(ty ? ty : i64Ty, nullptr, name);
+    }
+    /* Argument array for a runtime call taking (values, count).  One per
+     * call site in the entry block, so a site in a loop doesn't grow the stack */
+    llvm::AllocaInst* scratchArray(int n, const char* name) {
+        return createEntryAlloca(curFunc, name, llvm::ArrayType::get(i64Ty, n > 0 ? n : 1));
     }
 
-    void pushScope() { scopes.emplace_back(); typeScopes.emplace_back(); }
-    void popScope()  { if (!scopes.empty()) scopes.pop_back(); if (!typeScopes.empty()) typeScopes.pop_back(); }
+    void pushScope() { scopes.emplace_back(); typeScopes.emplace_back(); kindScopes.emplace_back(); }
+    void popScope()  {
+        if (!scopes.empty()) scopes.pop_back();
+        if (!typeScopes.empty()) typeScopes.pop_back();
+        if (!kindScopes.empty()) kindScopes.pop_back();
+    }
 
     llvm::AllocaInst* lookupLocal(const std::string& name) {
         for (int i = (int)scopes.size() - 1; i >= 0; i--) {
@@ -119,13 +223,45 @@ struct Codegen {
         return nullptr;
     }
 
-    void setLocal(const std::string& name, llvm::AllocaInst* a, const char* typeName = nullptr) {
+    void setLocal(const std::string& name, llvm::AllocaInst* a, const char* typeName = nullptr,
+                  SlotKind kind = SLOT_BOXED) {
         if (!scopes.empty()) {
             scopes.back()[name] = a;
             if (typeName) typeScopes.back()[name] = typeName;
+            kindScopes.back()[name] = kind;
         }
     }
 
+    SlotKind lookupKind(const std::string& name) {
+        for (int i = (int)kindScopes.size() - 1; i >= 0; i--) {
+            auto it = kindScopes[i].find(name);
+            if (it != kindScopes[i].end()) return it->second;
+        }
+        return SLOT_BOXED;
+    }
+
+    /* Which representation a freshly declared typed local should use */
+    SlotKind slotKindFor(const char* typeName) {
+        if (!typeName || mode == MODE_DYNAMIC) return SLOT_BOXED;
+        if (strcmp(typeName, "int") == 0)   return SLOT_INT;
+        if (strcmp(typeName, "float") == 0) return SLOT_FLOAT;
+        return SLOT_BOXED;
+    }
+
+    /* Like slotKindFor, but also accepts bool (for native signatures) */
+    SlotKind sigKindFor(const char* typeName) {
+        if (typeName && mode != MODE_DYNAMIC && strcmp(typeName, "bool") == 0) return SLOT_BOOL;
+        return slotKindFor(typeName);
+    }
+
+    llvm::Type* slotType(SlotKind k) {
+        if (k == SLOT_FLOAT) return f64Ty;
+        if (k == SLOT_BOOL)  return llvm::Type::getInt1Ty(ctx);
+        return i64Ty;
+    }
+
+    llvm::Value* zeroSlot(SlotKind k) { return llvm::Constant::getNullValue(slotType(k)); }
+
     llvm::Value* makeInt(int64_t n)  { return llvm::ConstantInt::get(i64Ty, tv_int(n)); }
     llvm::Value* makeFloat(double d) { return llvm::ConstantInt::get(i64Ty, tv_float(d)); }
     llvm::Value* makeBool(bool b)    { return llvm::ConstantInt::get(i64Ty, b ? TV_TRUE : TV_FALSE); }
@@ -135,6 +271,7 @@ struct Codegen {
         llvm::Function* fn = mod->getFunction(name);
         if (!fn) { fprintf(stderr, "BUG: runtime function '%s' not declared\n", name); return makeNull(); }
         llvm::CallInst* ci = B->CreateCall(fn, args);
+        ci->setAttributes(fn->getAttributes());
         if (fn->getReturnType()->isVoidTy()) return nullptr;
         return ci;
     }
@@ -149,8 +286,208 @@ struct Codegen {
         return llvm::ConstantExpr::getGetElementPtr(strConst->getType(), gv, idxs, true);
     }
 
+    /* String literals are emitted as immortal ObjString objects: laid out
+     * like the runtime struct, hash precomputed, never linked into
+     * all_objects (so scope exit, leak reports and shutdown never see
+     * them).  The header stays writable because incref/decref touch the
+     * refcount; is_manual plus a huge refcount keep decref and the
+     * in-place concat path away from it.  One object per distinct text. */
+    llvm::GlobalVariable* staticStringObj(const std::string& s) {
+        llvm::GlobalVariable*& gv = staticStrings[s];
+        if (!gv) {
+            llvm::Type* i8Ty = llvm::Type::getInt8Ty(ctx);
+            defineObjTypes();
+            llvm::Constant* header = llvm::ConstantStruct::get(objTy, {
+                i32Val(OBJ_STRING), i32Val(1 << 30),
+                llvm::ConstantInt::get(i8Ty, 1), llvm::ConstantInt::get(i8Ty, 0),
+                llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8PtrTy)) });
+            llvm::Constant* init = llvm::ConstantStruct::get(objStringTy, {
+                header, i32Val((int)s.size()), i32Val((int)s.size()),
+                llvm::ConstantInt::get(i8Ty, 0), makeStringConstant(s),
+                i32Val((int)hash_string(s.data(), (int)s.size())) });
+            gv = new llvm::GlobalVariable(*mod, objStringTy, false,
+                                          llvm::GlobalValue::PrivateLinkage, init, ".strobj");
+            gv->setAlignment(llvm::Align(8));
+        }
+        return gv;
+    }
+    /* Runtime object layouts mirrored from value.h, built on first use */
+    void defineObjTypes() {
+        if (objTy) return;
+        llvm::Type* i8Ty = llvm::Type::getInt8Ty(ctx);
+        objTy       = llvm::StructType::create(ctx, {i32Ty, i32Ty, i8Ty, i8Ty, i8PtrTy}, "Obj");
+        objStringTy = llvm::StructType::create(ctx, {objTy, i32Ty, i32Ty, i8Ty, i8PtrTy, i32Ty}, "ObjString");
+        objArrayTy  = llvm::StructType::create(ctx, {objTy, i8PtrTy, i64Ty, i64Ty, i8Ty}, "ObjArray");
+        objListTy   = llvm::StructType::create(ctx, {objTy, i8PtrTy, i32Ty, i32Ty, i8Ty, i32Ty, i8Ty, i32Ty, i8Ty}, "ObjList");
+    }
+
+    /* i1: boxed `v` is a (non-null) object of type `t`.  The header is
+     * only loaded once the tag says v is an object. */
+    llvm::Value* isObjType(llvm::Value* v, ObjType t) {
+        defineObjTypes();
+        llvm::BasicBlock* fromBB = B->GetInsertBlock();
+        llvm::BasicBlock* hdrBB  = llvm::BasicBlock::Create(ctx, "obj.hdr", curFunc);
+        llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(ctx, "obj.type", curFunc);
+        llvm::Value* payload = B->CreateAnd(v, 0x0000FFFFFFFFFFFFULL);
+        llvm::Value* isObj = B->CreateAnd(B->CreateICmpEQ(B->CreateLShr(v, 48), i64Val(0xFFFC)),
+                                          B->CreateICmpNE(payload, i64Val(0)));
+        B->CreateCondBr(isObj, hdrBB, doneBB);
+        B->SetInsertPoint(hdrBB);
+        llvm::Value* type = tbaa(B->CreateLoad(i32Ty, B->CreateStructGEP(objTy, B->CreateIntToPtr(payload, i8PtrTy), 0)), TBAA_OBJ_TYPE);
+        llvm::Value* match = B->CreateICmpEQ(type, i32Val(t));
+        B->CreateBr(doneBB);
+        B->SetInsertPoint(doneBB);
+        llvm::PHINode* phi = B->CreatePHI(llvm::Type::getInt1Ty(ctx), 2, "is.type");
+        phi->addIncoming(llvm::ConstantInt::getFalse(ctx), fromBB);
+        phi->addIncoming(match, hdrBB);
+        return phi;
+    }
+
+    /* Field `field` of the ObjList behind boxed `list` */
+    llvm::Value* listField(llvm::Value* list, unsigned field) {
+        defineObjTypes();
+        llvm::Value* l = B->CreateIntToPtr(B->CreateAnd(list, 0x0000FFFFFFFFFFFFULL), i8PtrTy);
+        return B->CreateStructGEP(objListTy, l, field);
+    }
+
+    /* Typed array (boxed int[]/float[] value): its element count, and the
+     * address of element `idx` in the unboxed data buffer */
+    llvm::Value* arrayCount(llvm::Value* boxed) {
+        defineObjTypes();
+        llvm::Value* arr = B->CreateIntToPtr(B->CreateAnd(boxed, 0x0000FFFFFFFFFFFFULL), i8PtrTy);
+        return tbaa(B->CreateLoad(i64Ty, B->CreateStructGEP(objArrayTy, arr, 2), "arr.count"), TBAA_ARRAY_COUNT);
+    }
+    llvm::Value* arrayData(llvm::Value* boxed) {
+        defineObjTypes();
+        llvm::Value* arr = B->CreateIntToPtr(B->CreateAnd(boxed, 0x0000FFFFFFFFFFFFULL), i8PtrTy);
+        return tbaa(B->CreateLoad(i8PtrTy, B->CreateStructGEP(objArrayTy, arr, 1), "arr.data"), TBAA_ARRAY_DATA);
+    }
+    llvm::Value* arrayElemPtr(llvm::Value* boxed, llvm::Value* idx, SlotKind k) {
+        return B->CreateInBoundsGEP(slotType(k), arrayData(boxed), idx);
+    }
+
+    /* Any value stored into an int[]/float[] variable goes through this */
+    llvm::Value* convertToArray(SlotKind ek, llvm::Value* v) {
+        return callRT("rt_cast", {v, i32Val(ek == SLOT_INT ? 4 : 5)});
+    }
+
+    /* Declared type of a local or global, if any */
+    const char* declaredType(const std::string& name) {
+        for (int i = (int)typeScopes.size() - 1; i >= 0; i--) {
+            if (scopes[i].count(name)) {
+                auto it = typeScopes[i].find(name);
+                return it != typeScopes[i].end() ? it->second.c_str() : nullptr;
+            }
+        }
+        auto it = globalTypes.find(name);
+        return it != globalTypes.end() ? it->second.c_str() : nullptr;
+    }
+
+    /* Zeroed RtFieldCache {shape, slot} for one obj.field site */
+    llvm::GlobalVariable* makeFieldCache() {
+        if (!fieldCacheTy) fieldCacheTy = llvm::StructType::create(ctx, {i8PtrTy, i32Ty}, "RtFieldCache");
+        return new llvm::GlobalVariable(*mod, fieldCacheTy, false, llvm::GlobalValue::PrivateLinkage,
+                                        llvm::ConstantAggregateZero::get(fieldCacheTy), ".ic");
+    }
+    llvm::Value* makeStaticString(const std::string& s) {
+        llvm::Value* bits = B->CreatePtrToInt(staticStringObj(s), i64Ty);
+        return B->CreateOr(bits, 0xFFFC000000000000ULL);       /* TV_TAG_OBJ  */
+    }
+
     llvm::ConstantInt* i32Val(int n) { return llvm::ConstantInt::get(llvm::Type::getInt32Ty(ctx), n); }
     llvm::ConstantInt* i64Val(int64_t n) { return llvm::ConstantInt::get(llvm::Type::getInt64Ty(ctx), n); }
+
+    /* ── NaN-box / unbox in IR (mirrors runtime.h) ───── */
+
+    llvm::Value* unboxInt(llvm::Value* v) {
+        v = B->CreateAnd(v, 0x0000FFFFFFFFFFFFULL);
+        v = B->CreateShl(v, 16);
+        return B->CreateAShr(v, 16);
+    }
+    llvm::Value* unboxFloat(llvm::Value* v) { return B->CreateBitCast(v, f64Ty); }
+    llvm::Value* boxInt(llvm::Value* v) {
+        v = B->CreateAnd(v, 0x0000FFFFFFFFFFFFULL);
+        return B->CreateOr(v, 0xFFFA000000000000ULL);          /* TV_TAG_INT  */
+    }
+    llvm::Value* boxFloat(llvm::Value* v) { return B->CreateBitCast(v, i64Ty); }
+    llvm::Value* boxBool(llvm::Value* v) {
+        v = B->CreateZExt(v, i64Ty);
+        return B->CreateOr(v, 0xFFFB000000000000ULL);          /* TV_TAG_BOOL */
+    }
+    llvm::Value* boxSlot(SlotKind k, llvm::Value* v) {
+        if (k == SLOT_INT)   return boxInt(v);
+        if (k == SLOT_FLOAT) return boxFloat(v);
+        if (k == SLOT_BOOL)  return boxBool(v);
+        return v;
+    }
+
+    /* Conditional branch that weights `unlikely` as the cold path */
+    void condBrLikely(llvm::Value* cond, llvm::BasicBlock* likely, llvm::BasicBlock* unlikely) {
+        llvm::MDBuilder md(ctx);
+        B->CreateCondBr(cond, likely, unlikely, md.createBranchWeights(2000, 1));
+    }
+
+    /* Unbox a value of unknown tag into a raw slot.  The expected tag is
+     * checked inline; anything else goes through rt_cast on a cold path. */
+    llvm::Value* coerceToSlot(SlotKind k, llvm::Value* v) {
+        if (k == SLOT_BOXED) return v;
+        llvm::Value* top = B->CreateLShr(v, 48);
+        llvm::Value* ok;
+        int castTag;
+        if (k == SLOT_INT) {
+            ok = B->CreateICmpEQ(top, i64Val(0xFFFA));          /* tag INT       */
+            castTag = 0;
+        } else if (k == SLOT_FLOAT) {
+            ok = B->CreateICmpULE(top, i64Val(0xFFF8));         /* plain double  */
+            castTag = 1;
+        } else {
+            ok = B->CreateICmpEQ(top, i64Val(0xFFFB));          /* tag BOOL      */
+            castTag = 3;
+        }
+        llvm::BasicBlock* fastBB = B->GetInsertBlock();
+        llvm::BasicBlock* castBB = llvm::BasicBlock::Create(ctx, "coerce.cast", curFunc);
+        llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(ctx, "coerce.done", curFunc);
+        condBrLikely(ok, doneBB, castBB);
+        B->SetInsertPoint(castBB);
+        llvm::Value* cast = callRT("rt_cast", {v, i32Val(castTag)});
+        B->CreateBr(doneBB);
+        B->SetInsertPoint(doneBB);
+        llvm::PHINode* phi = B->CreatePHI(i64Ty, 2, "coerced");
+        phi->addIncoming(v, fastBB);
+        phi->addIncoming(cast, castBB);
+        if (k == SLOT_BOOL) return unboxBool(phi);
+        return k == SLOT_INT ? unboxInt(phi) : unboxFloat(phi);
+    }
+
+    /* Payload of a value known to be a boxed bool, as i1 */
+    llvm::Value* unboxBool(llvm::Value* v) { return B->CreateTrunc(v, slotType(SLOT_BOOL)); }
+
+    /* Truthiness as i1: bools are tested inline, anything else goes
+     * through rt_is_truthy (which rejects non-bool conditions). */
+    llvm::Value* isTruthy(llvm::Value* v) {
+        llvm::BasicBlock* fastBB = B->GetInsertBlock();
+        llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(ctx, "truthy.slow", curFunc);
+        llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(ctx, "truthy.done", curFunc);
+        llvm::Value* isBool = B->CreateICmpEQ(B->CreateLShr(v, 48), i64Val(0xFFFB));
+        llvm::Value* fast = unboxBool(v);
+        condBrLikely(isBool, doneBB, slowBB);
+        B->SetInsertPoint(slowBB);
+        llvm::Value* slow = B->CreateICmpNE(callRT("rt_is_truthy", {v}), i32Val(0));
+        B->CreateBr(doneBB);
+        B->SetInsertPoint(doneBB);
+        llvm::PHINode* phi = B->CreatePHI(slotType(SLOT_BOOL), 2, "truthy");
+        phi->addIncoming(fast, fastBB);
+        phi->addIncoming(slow, slowBB);
+        return phi;
+    }
+
+    /* Convert between raw int (i64) and raw float (double) */
+    llvm::Value* convertSlot(SlotKind from, SlotKind to, llvm::Value* v) {
+        if (from == to) return v;
+        if (from == SLOT_INT && to == SLOT_FLOAT) return B->CreateSIToFP(v, f64Ty);
+        if (from == SLOT_FLOAT && to == SLOT_INT) return B->CreateFPToSI(v, i64Ty);
+        return v;
+    }
 };
 
 /* ══════════════════════════════════════════════════════════════════
@@ -162,6 +499,14 @@ static void codegenProgram(Codegen& cg, ASTNode* program);
 static void codegenStmt(Codegen& cg, ASTNode* node);
 static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node);
 
+/* Element kind of a typed array type ("int[]" / "float[]"), else SLOT_BOXED */
+static SlotKind arrayElemKind(const char* type_name) {
+    if (!type_name) return SLOT_BOXED;
+    if (strcmp(type_name, "int[]") == 0)   return SLOT_INT;
+    if (strcmp(type_name, "float[]") == 0) return SLOT_FLOAT;
+    return SLOT_BOXED;
+}
+
 static const char* llvm_infer_expr_type(Codegen& cg, ASTNode* node) {
     if (!node) return nullptr;
     switch (node->type) {
@@ -179,6 +524,8 @@ static const char* llvm_infer_expr_type(Codegen& cg, ASTNode* node) {
         }
         auto it = cg.globalTypes.find(node->as.identifier.name);
         if (it != cg.globalTypes.end()) return it->second.c_str();
+        auto ft = cg.flowTypes.find(node);
+        if (ft != cg.flowTypes.end()) return ft->second;
         return nullptr;
     }
     case NODE_CALL: {
@@ -187,6 +534,8 @@ static const char* llvm_infer_expr_type(Codegen& cg, ASTNode* node) {
             if (it != cg.funcSigs.end() && !it->second.ret_type.empty()) {
                 return it->second.ret_type.c_str();
             }
+            if (it == cg.funcSigs.end() && strcmp(node->as.call.callee->as.identifier.name, "len") == 0)
+                return "int";
         }
         return nullptr;
     }
@@ -207,10 +556,743 @@ static const char* llvm_infer_expr_type(Codegen& cg, ASTNode* node) {
             return "int";
         return lt; 
     }
+    case NODE_UNARY: {
+        if (node->as.unary.op == TOKEN_BANG) return "bool";
+        if (node->as.unary.op == TOKEN_MINUS) {
+            const char* t = llvm_infer_expr_type(cg, node->as.unary.operand);
+            if (t && (strcmp(t, "int") == 0 || strcmp(t, "float") == 0)) return t;
+        }
+        return nullptr;
+    }
+    case NODE_POSTFIX:
+        return llvm_infer_expr_type(cg, node->as.postfix.operand);
+    case NODE_INDEX: {
+        SlotKind ek = arrayElemKind(llvm_infer_expr_type(cg, node->as.index_access.object));
+        if (ek == SLOT_INT)   return "int";
+        if (ek == SLOT_FLOAT) return "float";
+        return nullptr;
+    }
     default: return nullptr;
     }
 }
 
+/* ══════════════════════════════════════════════════════════════════
+ *  Unboxed numeric codegen
+ *  Expressions statically known to be int/float are computed on raw
+ *  i64/double values; boxing only happens where a value escapes.
+ * ══════════════════════════════════════════════════════════════════ */
+
+static SlotKind numericKind(const char* type_name) {
+    if (!type_name) return SLOT_BOXED;
+    if (strcmp(type_name, "int") == 0)   return SLOT_INT;
+    if (strcmp(type_name, "float") == 0) return SLOT_FLOAT;
+    return SLOT_BOXED;
+}
+
+/* Text of a NODE_STRING_LIT; a literal ends at its first NUL, as the
+ * C strings it used to be built from did */
+static std::string literalText(ASTNode* node) {
+    std::string s(node->as.string_literal.value, node->as.string_literal.length);
+    s.resize(strlen(s.c_str()));
+    return s;
+}
+
+static bool isComparisonOp(TokenType op) {
+    return op == TOKEN_EQUAL_EQUAL || op == TOKEN_BANG_EQUAL ||
+           op == TOKEN_LESS || op == TOKEN_GREATER ||
+           op == TOKEN_LESS_EQUAL || op == TOKEN_GREATER_EQUAL;
+}
+
+/* True if `node`'s static type relies on the flow pass rather than on
+ * declarations and literals alone */
+static bool usesFlowType(Codegen& cg, ASTNode* node) {
+    switch (node->type) {
+    case NODE_IDENTIFIER: {
+        const char* name = node->as.identifier.name;
+        for (auto& scope : cg.typeScopes)
+            if (scope.count(name)) return false;
+        return !cg.globalTypes.count(name) && cg.flowTypes.count(node);
+    }
+    case NODE_BINARY:  return usesFlowType(cg, node->as.binary.left) || usesFlowType(cg, node->as.binary.right);
+    case NODE_UNARY:   return usesFlowType(cg, node->as.unary.operand);
+    case NODE_POSTFIX: return usesFlowType(cg, node->as.postfix.operand);
+    default:           return false;
+    }
+}
+
+/* True when a NODE_BINARY can be computed on raw machine values.
+ * *opKind receives the operand representation (int, or float if mixed). */
+static bool binaryIsNumeric(Codegen& cg, ASTNode* node, SlotKind* opKind) {
+    if (cg.mode != MODE_STATIC && cg.mode != MODE_BOTH) return false;
+    SlotKind lk = numericKind(llvm_infer_expr_type(cg, node->as.binary.left));
+    SlotKind rk = numericKind(llvm_infer_expr_type(cg, node->as.binary.right));
+    if (lk == SLOT_BOXED || rk == SLOT_BOXED) return false;
+    SlotKind k = (lk == SLOT_FLOAT || rk == SLOT_FLOAT) ? SLOT_FLOAT : SLOT_INT;
+    *opKind = k;
+    switch (node->as.binary.op) {
+    case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_STAR: case TOKEN_SLASH:
+        return true;
+    case TOKEN_PERCENT:
+        return k == SLOT_INT;   /* float % is a runtime error — leave it to rt_mod */
+    case TOKEN_EQUAL_EQUAL: case TOKEN_BANG_EQUAL:
+        /* Declared int/float operands compare numerically; values that are
+         * only known through the flow pass keep rt_eq semantics, where an
+         * int never equals a float */
+        return lk == rk || (!usesFlowType(cg, node->as.binary.left) && !usesFlowType(cg, node->as.binary.right));
+    default:
+        return isComparisonOp(node->as.binary.op);
+    }
+}
+
+static llvm::Value* emitArith(Codegen& cg, TokenType op, SlotKind k, llvm::Value* l, llvm::Value* r) {
+    if (op == TOKEN_SLASH || op == TOKEN_PERCENT) {
+        /* A zero divisor is a runtime error; let rt_div/rt_mod report it */
+        llvm::Value* zero = (k == SLOT_FLOAT) ? cg.B->CreateFCmpOEQ(r, llvm::ConstantFP::get(cg.f64Ty, 0.0))
+                                              : cg.B->CreateICmpEQ(r, cg.i64Val(0));
+        llvm::BasicBlock* okBB   = llvm::BasicBlock::Create(cg.ctx, "div.ok", cg.curFunc);
+        llvm::BasicBlock* zeroBB = llvm::BasicBlock::Create(cg.ctx, "div.zero", cg.curFunc);
+        cg.condBrLikely(cg.B->CreateNot(zero), okBB, zeroBB);
+        cg.B->SetInsertPoint(zeroBB);
+        cg.callRT(op == TOKEN_SLASH ? "rt_div" : "rt_mod", {cg.boxSlot(k, l), cg.boxSlot(k, r)});
+        cg.B->CreateUnreachable();
+        cg.B->SetInsertPoint(okBB);
+    }
+    if (k == SLOT_FLOAT) {
+        switch (op) {
+        case TOKEN_PLUS:  return cg.B->CreateFAdd(l, r);
+        case TOKEN_MINUS: return cg.B->CreateFSub(l, r);
+        case TOKEN_STAR:  return cg.B->CreateFMul(l, r);
+        case TOKEN_SLASH: return cg.B->CreateFDiv(l, r);
+        default: return nullptr;
+        }
+    }
+    switch (op) {
+    case TOKEN_PLUS:    return cg.B->CreateAdd(l, r);
+    case TOKEN_MINUS:   return cg.B->CreateSub(l, r);
+    case TOKEN_STAR:    return cg.B->CreateMul(l, r);
+    case TOKEN_SLASH: case TOKEN_PERCENT: {
+        /* Raw ints are full 64-bit, so INT64_MIN / -1 is reachable and
+         * would trap; a -1 divisor is answered as -l (wrapping) or 0 */
+        llvm::Value* negOne = cg.B->CreateICmpEQ(r, cg.i64Val(-1));
+        llvm::Value* safe   = cg.B->CreateSelect(negOne, cg.i64Val(1), r);
+        if (op == TOKEN_SLASH)
+            return cg.B->CreateSelect(negOne, cg.B->CreateSub(cg.i64Val(0), l), cg.B->CreateSDiv(l, safe));
+        return cg.B->CreateSelect(negOne, cg.i64Val(0), cg.B->CreateSRem(l, safe));
+    }
+    default: return nullptr;
+    }
+}
+
+static llvm::Value* emitCompare(Codegen& cg, TokenType op, SlotKind k, llvm::Value* l, llvm::Value* r) {
+    if (k == SLOT_FLOAT) {
+        switch (op) {
+        case TOKEN_EQUAL_EQUAL:   return cg.B->CreateFCmpOEQ(l, r);
+        case TOKEN_BANG_EQUAL:    return cg.B->CreateFCmpUNE(l, r);
+        case TOKEN_LESS:          return cg.B->CreateFCmpOLT(l, r);
+        case TOKEN_GREATER:       return cg.B->CreateFCmpOGT(l, r);
+        /* rt_lte/rt_gte are !(a > b) / !(a < b), so NaN compares true */
+        case TOKEN_LESS_EQUAL:    return cg.B->CreateFCmpULE(l, r);
+        case TOKEN_GREATER_EQUAL: return cg.B->CreateFCmpUGE(l, r);
+        default: return nullptr;
+        }
+    }
+    switch (op) {
+    case TOKEN_EQUAL_EQUAL:   return cg.B->CreateICmpEQ(l, r);
+    case TOKEN_BANG_EQUAL:    return cg.B->CreateICmpNE(l, r);
+    case TOKEN_LESS:          return cg.B->CreateICmpSLT(l, r);
+    case TOKEN_GREATER:       return cg.B->CreateICmpSGT(l, r);
+    case TOKEN_LESS_EQUAL:    return cg.B->CreateICmpSLE(l, r);
+    case TOKEN_GREATER_EQUAL: return cg.B->CreateICmpSGE(l, r);
+    default: return nullptr;
+    }
+}
+
+static const FuncSigInfo* nativeSigFor(Codegen& cg, ASTNode* call);
+static llvm::Value* emitNativeCall(Codegen& cg, ASTNode* call, const FuncSigInfo& sig);
+
+/* ── Typed arrays ────────────────────────────────────
+ * int[] / float[] values are always ObjArrays of their declared kind
+ * (declarations, assignments, parameters and returns convert through
+ * rt_cast), so an int-typed index is bounds-checked against the count and
+ * the element is loaded or stored directly.  A failed check takes the
+ * generic rt_index_get/rt_index_set path, which reports (or ignores) the
+ * bad index exactly like a list does. */
+
+/* Element kind if `obj[index]` can use the inline path, else SLOT_BOXED */
+static SlotKind inlineArrayAccess(Codegen& cg, ASTNode* obj, ASTNode* index) {
+    if (cg.mode == MODE_DYNAMIC || !index) return SLOT_BOXED;
+    SlotKind ek = arrayElemKind(llvm_infer_expr_type(cg, obj));
+    if (ek == SLOT_BOXED || numericKind(llvm_infer_expr_type(cg, index)) != SLOT_INT) return SLOT_BOXED;
+    return ek;
+}
+
+/* The in-bounds record for `obj[index]`, if the enclosing loops have one */
+static const Codegen::CheckedIndex* checkedIndexFor(Codegen& cg, ASTNode* obj, ASTNode* index) {
+    if (obj->type != NODE_IDENTIFIER || !index || index->type != NODE_IDENTIFIER) return nullptr;
+    for (auto it = cg.checkedIndices.rbegin(); it != cg.checkedIndices.rend(); ++it)
+        if (it->array == obj->as.identifier.name && it->index == index->as.identifier.name) return &*it;
+    return nullptr;
+}
+
+/* `ci` marks an index the enclosing loop keeps in bounds */
+static llvm::Value* emitArrayLoad(Codegen& cg, llvm::Value* arr, llvm::Value* idx, SlotKind ek,
+                                  const Codegen::CheckedIndex* ci = nullptr) {
+    if (ci && ci->data)
+        return cg.tbaa(cg.B->CreateLoad(cg.slotType(ek), cg.B->CreateInBoundsGEP(cg.slotType(ek), ci->data, idx), "arr.elem"),
+                       Codegen::TBAA_ARRAY_ELEM);
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* fastBB = llvm::BasicBlock::Create(cg.ctx, "arr.load", F);
+    llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(cg.ctx, "arr.oob", F);
+    llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(cg.ctx, "arr.done", F);
+    cg.condBrLikely(cg.B->CreateICmpULT(idx, cg.arrayCount(arr)), fastBB, slowBB);
+    cg.B->SetInsertPoint(fastBB);
+    llvm::Value* fast = cg.tbaa(cg.B->CreateLoad(cg.slotType(ek), cg.arrayElemPtr(arr, idx, ek), "arr.elem"),
+                                 Codegen::TBAA_ARRAY_ELEM);
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    llvm::Value* boxed = cg.callRT("rt_index_get", {arr, cg.boxInt(idx)});
+    llvm::Value* slow = (ek == SLOT_INT) ? cg.unboxInt(boxed) : cg.unboxFloat(boxed);
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(doneBB);
+    llvm::PHINode* phi = cg.B->CreatePHI(cg.slotType(ek), 2, "arr.val");
+    phi->addIncoming(fast, fastBB);
+    phi->addIncoming(slow, slowBB);
+    return phi;
+}
+
+static void emitArrayStore(Codegen& cg, llvm::Value* arr, llvm::Value* idx, SlotKind ek, llvm::Value* raw,
+                           const Codegen::CheckedIndex* ci = nullptr) {
+    if (ci && ci->data) {
+        cg.tbaa(cg.B->CreateStore(raw, cg.B->CreateInBoundsGEP(cg.slotType(ek), ci->data, idx)), Codegen::TBAA_ARRAY_ELEM);
+        return;
+    }
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* fastBB = llvm::BasicBlock::Create(cg.ctx, "arr.store", F);
+    llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(cg.ctx, "arr.oob", F);
+    llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(cg.ctx, "arr.done", F);
+    cg.condBrLikely(cg.B->CreateICmpULT(idx, cg.arrayCount(arr)), fastBB, slowBB);
+    cg.B->SetInsertPoint(fastBB);
+    cg.tbaa(cg.B->CreateStore(raw, cg.arrayElemPtr(arr, idx, ek)), Codegen::TBAA_ARRAY_ELEM);
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    cg.callRT("rt_index_set", {arr, cg.boxInt(idx), cg.boxSlot(ek, raw)});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(doneBB);
+}
+
+/* ── Typed lists and maps ────────────────────────────
+ * A `list` or `map` variable usually holds what it says, but nothing
+ * forces it to, so the inline paths test the object header first.  Lists
+ * are then bounds-checked and int/float storage is read or written
+ * directly; other storage goes through rt_list_item/rt_list_store, which
+ * skip the index dispatch.  Maps call the hash probe directly.  Anything
+ * that fails a test takes rt_index_get/rt_index_set as before. */
+
+/* Whether `obj[index]` may use the inline list path */
+static bool inlineListAccess(Codegen& cg, ASTNode* obj, ASTNode* index) {
+    if (cg.mode == MODE_DYNAMIC || !index) return false;
+    const char* type = llvm_infer_expr_type(cg, obj);
+    return type && strcmp(type, "list") == 0 && numericKind(llvm_infer_expr_type(cg, index)) == SLOT_INT;
+}
+
+static bool inlineMapAccess(Codegen& cg, ASTNode* obj, ASTNode* index) {
+    if (cg.mode == MODE_DYNAMIC || !index) return false;
+    const char* type = llvm_infer_expr_type(cg, obj);
+    return type && strcmp(type, "map") == 0;
+}
+
+/* Branch to `okBB` if `list[idx]` is an in-bounds list element, else to
+ * `slowBB`.  `ci` (an in-bounds index from the enclosing loop) replaces
+ * both tests with the loop's own list test. */
+static void emitListGuard(Codegen& cg, llvm::Value* list, llvm::Value* idx, const Codegen::CheckedIndex* ci,
+                          llvm::BasicBlock* okBB, llvm::BasicBlock* slowBB) {
+    if (ci) { cg.condBrLikely(ci->isList, okBB, slowBB); return; }
+    llvm::BasicBlock* boundsBB = llvm::BasicBlock::Create(cg.ctx, "list.bounds", cg.curFunc);
+    cg.condBrLikely(cg.isObjType(list, OBJ_LIST), boundsBB, slowBB);
+    cg.B->SetInsertPoint(boundsBB);
+    llvm::Value* count = cg.tbaa(cg.B->CreateLoad(cg.i32Ty, cg.listField(list, 2), "list.count"), Codegen::TBAA_LIST_COUNT);
+    cg.condBrLikely(cg.B->CreateICmpULT(idx, cg.B->CreateZExt(count, cg.i64Ty)), okBB, slowBB);
+}
+
+static llvm::Value* emitListGet(Codegen& cg, llvm::Value* list, llvm::Value* idx,
+                                const Codegen::CheckedIndex* ci = nullptr) {
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* loadBB  = llvm::BasicBlock::Create(cg.ctx, "list.load", F);
+    llvm::BasicBlock* intsBB  = llvm::BasicBlock::Create(cg.ctx, "list.ints", F);
+    llvm::BasicBlock* fltsBB  = llvm::BasicBlock::Create(cg.ctx, "list.floats", F);
+    llvm::BasicBlock* otherBB = llvm::BasicBlock::Create(cg.ctx, "list.item", F);
+    llvm::BasicBlock* slowBB  = llvm::BasicBlock::Create(cg.ctx, "list.generic", F);
+    llvm::BasicBlock* doneBB  = llvm::BasicBlock::Create(cg.ctx, "list.done", F);
+    emitListGuard(cg, list, idx, ci, loadBB, slowBB);
+
+    cg.B->SetInsertPoint(loadBB);
+    llvm::Value* storage = cg.tbaa(cg.B->CreateLoad(cg.i32Ty, cg.listField(list, 7), "list.storage"), Codegen::TBAA_LIST_STORAGE);
+    llvm::Value* items = cg.tbaa(cg.B->CreateLoad(cg.i8PtrTy, cg.listField(list, 1), "list.items"), Codegen::TBAA_LIST_ITEMS);
+    llvm::SwitchInst* sw = cg.B->CreateSwitch(storage, otherBB, 2);
+    sw->addCase(llvm::cast<llvm::ConstantInt>(cg.i32Val(LIST_INTS)), intsBB);
+    sw->addCase(llvm::cast<llvm::ConstantInt>(cg.i32Val(LIST_FLOATS)), fltsBB);
+
+    cg.B->SetInsertPoint(intsBB);
+    llvm::Value* iv = cg.boxInt(cg.tbaa(cg.B->CreateLoad(cg.i64Ty, cg.B->CreateInBoundsGEP(cg.i64Ty, items, idx), "list.int"),
+                                        Codegen::TBAA_LIST_ELEM));
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(fltsBB);
+    llvm::Value* fv = cg.boxFloat(cg.tbaa(cg.B->CreateLoad(cg.f64Ty, cg.B->CreateInBoundsGEP(cg.f64Ty, items, idx), "list.float"),
+                                          Codegen::TBAA_LIST_ELEM));
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(otherBB);
+    llvm::Value* ov = cg.callRT("rt_list_item", {list, idx});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    llvm::Value* sv = cg.callRT("rt_index_get", {list, cg.boxInt(idx)});
+    cg.B->CreateBr(doneBB);
+
+    cg.B->SetInsertPoint(doneBB);
+    llvm::PHINode* phi = cg.B->CreatePHI(cg.i64Ty, 4, "list.val");
+    phi->addIncoming(iv, intsBB);
+    phi->addIncoming(fv, fltsBB);
+    phi->addIncoming(ov, otherBB);
+    phi->addIncoming(sv, slowBB);
+    return phi;
+}
+
+/* `raw` is the value unboxed when it is statically int/float (kind `vk`);
+ * it is stored directly if the list already has matching storage */
+static void emitListSet(Codegen& cg, llvm::Value* list, llvm::Value* idx, llvm::Value* val,
+                        SlotKind vk, llvm::Value* raw, const Codegen::CheckedIndex* ci = nullptr) {
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* storeBB = llvm::BasicBlock::Create(cg.ctx, "list.store", F);
+    llvm::BasicBlock* otherBB = llvm::BasicBlock::Create(cg.ctx, "list.put", F);
+    llvm::BasicBlock* slowBB  = llvm::BasicBlock::Create(cg.ctx, "list.generic", F);
+    llvm::BasicBlock* doneBB  = llvm::BasicBlock::Create(cg.ctx, "list.done", F);
+    emitListGuard(cg, list, idx, ci, storeBB, slowBB);
+
+    cg.B->SetInsertPoint(storeBB);
+    if (vk == SLOT_INT || vk == SLOT_FLOAT) {
+        llvm::BasicBlock* rawBB = llvm::BasicBlock::Create(cg.ctx, "list.raw", F);
+        llvm::Value* storage = cg.tbaa(cg.B->CreateLoad(cg.i32Ty, cg.listField(list, 7), "list.storage"), Codegen::TBAA_LIST_STORAGE);
+        cg.condBrLikely(cg.B->CreateICmpEQ(storage, cg.i32Val(vk == SLOT_INT ? LIST_INTS : LIST_FLOATS)), rawBB, otherBB);
+        cg.B->SetInsertPoint(rawBB);
+        llvm::Value* items = cg.tbaa(cg.B->CreateLoad(cg.i8PtrTy, cg.listField(list, 1), "list.items"), Codegen::TBAA_LIST_ITEMS);
+        cg.tbaa(cg.B->CreateStore(raw, cg.B->CreateInBoundsGEP(cg.slotType(vk), items, idx)), Codegen::TBAA_LIST_ELEM);
+        cg.B->CreateBr(doneBB);
+    } else {
+        cg.B->CreateBr(otherBB);
+    }
+    cg.B->SetInsertPoint(otherBB);
+    cg.callRT("rt_list_store", {list, idx, val});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    cg.callRT("rt_index_set", {list, cg.boxInt(idx), val});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(doneBB);
+}
+
+static llvm::Value* emitMapGet(Codegen& cg, llvm::Value* map, llvm::Value* key) {
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* fastBB = llvm::BasicBlock::Create(cg.ctx, "map.get", F);
+    llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(cg.ctx, "map.generic", F);
+    llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(cg.ctx, "map.done", F);
+    cg.condBrLikely(cg.isObjType(map, OBJ_MAP), fastBB, slowBB);
+    cg.B->SetInsertPoint(fastBB);
+    llvm::Value* fast = cg.callRT("rt_map_get", {map, key});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    llvm::Value* slow = cg.callRT("rt_index_get", {map, key});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(doneBB);
+    llvm::PHINode* phi = cg.B->CreatePHI(cg.i64Ty, 2, "map.val");
+    phi->addIncoming(fast, fastBB);
+    phi->addIncoming(slow, slowBB);
+    return phi;
+}
+
+static void emitMapSet(Codegen& cg, llvm::Value* map, llvm::Value* key, llvm::Value* val) {
+    llvm::Function* F = cg.curFunc;
+    llvm::BasicBlock* fastBB = llvm::BasicBlock::Create(cg.ctx, "map.set", F);
+    llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(cg.ctx, "map.generic", F);
+    llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(cg.ctx, "map.done", F);
+    cg.condBrLikely(cg.isObjType(map, OBJ_MAP), fastBB, slowBB);
+    cg.B->SetInsertPoint(fastBB);
+    cg.callRT("rt_map_set", {map, key, val});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(slowBB);
+    cg.callRT("rt_index_set", {map, key, val});
+    cg.B->CreateBr(doneBB);
+    cg.B->SetInsertPoint(doneBB);
+}
+
+/* len(a) of a typed array as a raw i64, or null if `call` is not that */
+static llvm::Value* emitArrayLen(Codegen& cg, ASTNode* call) {
+    ASTNode* callee = call->as.call.callee;
+    if (cg.mode == MODE_DYNAMIC || callee->type != NODE_IDENTIFIER || call->as.call.arg_count != 1 ||
+        strcmp(callee->as.identifier.name, "len") != 0 || cg.funcSigs.count("len"))
+        return nullptr;
+    if (arrayElemKind(llvm_infer_expr_type(cg, call->as.call.args[0])) == SLOT_BOXED) return nullptr;
+    return cg.arrayCount(codegenExpr(cg, call->as.call.args[0]));
+}
+
+/* Evaluate `node` as a raw value of kind `want` (SLOT_INT → i64,
+ * SLOT_FLOAT → double).  Values of unknown type are coerced at runtime. */
+static llvm::Value* codegenNumeric(Codegen& cg, ASTNode* node, SlotKind want) {
+    switch (node->type) {
+    case NODE_INT_LIT:
+        if (want == SLOT_FLOAT) return llvm::ConstantFP::get(cg.f64Ty, (double)node->as.int_literal);
+        return cg.i64Val(node->as.int_literal);
+    case NODE_FLOAT_LIT:
+        if (want == SLOT_INT) return cg.i64Val((int64_t)node->as.float_literal);
+        return llvm::ConstantFP::get(cg.f64Ty, node->as.float_literal);
+    case NODE_IDENTIFIER: {
+        const char* name = node->as.identifier.name;
+        llvm::AllocaInst* a = cg.lookupLocal(name);
+        SlotKind k = cg.lookupKind(name);
+        if (a && k != SLOT_BOXED)
+            return cg.convertSlot(k, want, cg.loadSlot(cg.slotType(k), a, name));
+        break;
+    }
+    case NODE_BINARY: {
+        SlotKind opKind;
+        if (binaryIsNumeric(cg, node, &opKind) && !isComparisonOp(node->as.binary.op)) {
+            llvm::Value* l = codegenNumeric(cg, node->as.binary.left, opKind);
+            llvm::Value* r = codegenNumeric(cg, node->as.binary.right, opKind);
+            return cg.convertSlot(opKind, want, emitArith(cg, node->as.binary.op, opKind, l, r));
+        }
+        break;
+    }
+    case NODE_UNARY: {
+        if (node->as.unary.op != TOKEN_MINUS || (cg.mode != MODE_STATIC && cg.mode != MODE_BOTH)) break;
+        SlotKind k = numericKind(llvm_infer_expr_type(cg, node->as.unary.operand));
+        if (k == SLOT_BOXED) break;
+        llvm::Value* v = codegenNumeric(cg, node->as.unary.operand, k);
+        v = (k == SLOT_FLOAT) ? cg.B->CreateFNeg(v) : cg.B->CreateNeg(v);
+        return cg.convertSlot(k, want, v);
+    }
+    case NODE_CALL: {
+        const FuncSigInfo* sig = nativeSigFor(cg, node);
+        if (sig && (sig->ret_kind == SLOT_INT || sig->ret_kind == SLOT_FLOAT))
+            return cg.convertSlot(sig->ret_kind, want, emitNativeCall(cg, node, *sig));
+        if (llvm::Value* n = emitArrayLen(cg, node)) return cg.convertSlot(SLOT_INT, want, n);
+        break;
+    }
+    case NODE_INDEX: {
+        SlotKind ek = inlineArrayAccess(cg, node->as.index_access.object, node->as.index_access.index);
+        if (ek == SLOT_BOXED) break;
+        const Codegen::CheckedIndex* ci = checkedIndexFor(cg, node->as.index_access.object, node->as.index_access.index);
+        llvm::Value* arr = codegenExpr(cg, node->as.index_access.object);
+        llvm::Value* idx = codegenNumeric(cg, node->as.index_access.index, SLOT_INT);
+        return cg.convertSlot(ek, want, emitArrayLoad(cg, arr, idx, ek, ci));
+    }
+    default:
+        break;
+    }
+    /* Anything else is evaluated boxed and unboxed by its static type */
+    llvm::Value* boxed = codegenExpr(cg, node);
+    SlotKind k = (cg.mode == MODE_DYNAMIC) ? SLOT_BOXED : numericKind(llvm_infer_expr_type(cg, node));
+    if (k == SLOT_BOXED) return cg.coerceToSlot(want, boxed);
+    llvm::Value* raw = (k == SLOT_INT) ? cg.unboxInt(boxed) : cg.unboxFloat(boxed);
+    return cg.convertSlot(k, want, raw);
+}
+
+/* A numeric comparison as a native i1 (caller checked binaryIsNumeric) */
+static llvm::Value* codegenNumericCmp(Codegen& cg, ASTNode* node, SlotKind opKind) {
+    llvm::Value* l = codegenNumeric(cg, node->as.binary.left, opKind);
+    llvm::Value* r = codegenNumeric(cg, node->as.binary.right, opKind);
+    return emitCompare(cg, node->as.binary.op, opKind, l, r);
+}
+
+/* An operand whose static type rules out the INT/FLOAT fast paths */
+static bool knownNonNumeric(const char* type_name) {
+    return type_name && numericKind(type_name) == SLOT_BOXED;
+}
+
+/* Binary op on values of unknown type.  Both-INT and both-FLOAT operands
+ * are handled inline (emitArith guards zero divisors); anything else
+ * (mixed, strings, ...) takes the cold path into the generic runtime
+ * function.  With `asCond` a comparison yields a raw i1 instead of a
+ * boxed bool. */
+static llvm::Value* emitTagCheckedBinary(Codegen& cg, TokenType op, const char* rtName,
+                                         llvm::Value* lhs, llvm::Value* rhs, bool asCond = false) {
+    llvm::Function* F = cg.curFunc;
+    bool cmp = isComparisonOp(op);
+    llvm::BasicBlock* intBB  = llvm::BasicBlock::Create(cg.ctx, "dyn.int", F);
+    llvm::BasicBlock* fchkBB = (op != TOKEN_PERCENT) ? llvm::BasicBlock::Create(cg.ctx, "dyn.fchk", F) : nullptr;
+    llvm::BasicBlock* slowBB = llvm::BasicBlock::Create(cg.ctx, "dyn.slow", F);
+    llvm::BasicBlock* doneBB = llvm::BasicBlock::Create(cg.ctx, "dyn.done", F);
+    std::vector<std::pair<llvm::Value*, llvm::BasicBlock*>> results;
+
+    llvm::Value* ltop = cg.B->CreateLShr(lhs, 48);
+    llvm::Value* rtop = cg.B->CreateLShr(rhs, 48);
+    llvm::Value* bothInt = cg.B->CreateAnd(cg.B->CreateICmpEQ(ltop, cg.i64Val(0xFFFA)),
+                                           cg.B->CreateICmpEQ(rtop, cg.i64Val(0xFFFA)));
+    cg.condBrLikely(bothInt, intBB, fchkBB ? fchkBB : slowBB);
+
+    /* INT ⊕ INT */
+    cg.B->SetInsertPoint(intBB);
+    llvm::Value* li = cg.unboxInt(lhs);
+    llvm::Value* ri = cg.unboxInt(rhs);
+    llvm::Value* ires = cmp ? emitCompare(cg, op, SLOT_INT, li, ri) : emitArith(cg, op, SLOT_INT, li, ri);
+    results.push_back({asCond ? ires : cg.boxSlot(cmp ? SLOT_BOOL : SLOT_INT, ires), cg.B->GetInsertBlock()});
+    cg.B->CreateBr(doneBB);
+
+    /* FLOAT ⊕ FLOAT (float % is always an error, so it skips this) */
+    if (fchkBB) {
+        cg.B->SetInsertPoint(fchkBB);
+        llvm::Value* bothFloat = cg.B->CreateAnd(cg.B->CreateICmpULE(ltop, cg.i64Val(0xFFF8)),
+                                                 cg.B->CreateICmpULE(rtop, cg.i64Val(0xFFF8)));
+        llvm::BasicBlock* fltBB = llvm::BasicBlock::Create(cg.ctx, "dyn.float", F);
+        cg.condBrLikely(bothFloat, fltBB, slowBB);
+        cg.B->SetInsertPoint(fltBB);
+        llvm::Value* lf = cg.unboxFloat(lhs);
+        llvm::Value* rf = cg.unboxFloat(rhs);
+        llvm::Value* fres = cmp ? emitCompare(cg, op, SLOT_FLOAT, lf, rf) : emitArith(cg, op, SLOT_FLOAT, lf, rf);
+        results.push_back({asCond ? fres : cg.boxSlot(cmp ? SLOT_BOOL : SLOT_FLOAT, fres), cg.B->GetInsertBlock()});
+        cg.B->CreateBr(doneBB);
+    }
+
+    /* Everything else: generic runtime op */
+    cg.B->SetInsertPoint(slowBB);
+    llvm::Value* slow = cg.callRT(rtName, {lhs, rhs});
+    results.push_back({asCond ? cg.unboxBool(slow) : slow, slowBB});
+    cg.B->CreateBr(doneBB);
+
+    cg.B->SetInsertPoint(doneBB);
+    llvm::PHINode* phi = cg.B->CreatePHI(asCond ? cg.slotType(SLOT_BOOL) : cg.i64Ty,
+                                         (unsigned)results.size(), "dyn.val");
+    for (auto& r : results) phi->addIncoming(r.first, r.second);
+    return phi;
+}
+
+static const char* rtNameForBinary(TokenType op) {
+    switch (op) {
+    case TOKEN_PLUS:          return "rt_add";
+    case TOKEN_MINUS:         return "rt_sub";
+    case TOKEN_STAR:          return "rt_mul";
+    case TOKEN_SLASH:         return "rt_div";
+    case TOKEN_PERCENT:       return "rt_mod";
+    case TOKEN_EQUAL_EQUAL:   return "rt_eq";
+    case TOKEN_BANG_EQUAL:    return "rt_neq";
+    case TOKEN_LESS:          return "rt_lt";
+    case TOKEN_GREATER:       return "rt_gt";
+    case TOKEN_LESS_EQUAL:    return "rt_lte";
+    case TOKEN_GREATER_EQUAL: return "rt_gte";
+    default: return nullptr;
+    }
+}
+
+static bool isKnownBool(Codegen& cg, ASTNode* node) {
+    const char* t = llvm_infer_expr_type(cg, node);
+    return cg.mode != MODE_DYNAMIC && t && strcmp(t, "bool") == 0;
+}
+
+/* Evaluate a condition as a native i1 for branches.  Comparisons and
+ * logical ops never materialize a boxed bool; other values are tested
+ * with an inline bool-tag check before falling back to rt_is_truthy. */
+static llvm::Value* codegenCond(Codegen& cg, ASTNode* node) {
+    llvm::Type* i1 = cg.slotType(SLOT_BOOL);
+    switch (node->type) {
+    case NODE_BOOL_LIT:
+        return llvm::ConstantInt::get(i1, node->as.bool_literal ? 1 : 0);
+    case NODE_UNARY:
+        /* Only fuse `!` on proven bools — rt_not rejects null, truthiness doesn't */
+        if (node->as.unary.op == TOKEN_BANG && isKnownBool(cg, node->as.unary.operand))
+            return cg.B->CreateNot(codegenCond(cg, node->as.unary.operand));
+        break;
+    case NODE_BINARY: {
+        TokenType op = node->as.binary.op;
+        if (op == TOKEN_AND || op == TOKEN_OR) {
+            llvm::Function* F = cg.curFunc;
+            llvm::Value* l = codegenCond(cg, node->as.binary.left);
+            llvm::BasicBlock* lhsBB = cg.B->GetInsertBlock();
+            llvm::BasicBlock* rhsBB = llvm::BasicBlock::Create(cg.ctx, op == TOKEN_AND ? "and.rhs" : "or.rhs", F);
+            llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(cg.ctx, op == TOKEN_AND ? "and.merge" : "or.merge", F);
+            if (op == TOKEN_AND) cg.B->CreateCondBr(l, rhsBB, mergeBB);
+            else                 cg.B->CreateCondBr(l, mergeBB, rhsBB);
+            cg.B->SetInsertPoint(rhsBB);
+            llvm::Value* r = codegenCond(cg, node->as.binary.right);
+            llvm::BasicBlock* rhsEnd = cg.B->GetInsertBlock();
+            cg.B->CreateBr(mergeBB);
+            cg.B->SetInsertPoint(mergeBB);
+            llvm::PHINode* phi = cg.B->CreatePHI(i1, 2, op == TOKEN_AND ? "and.cond" : "or.cond");
+            phi->addIncoming(llvm::ConstantInt::get(i1, op == TOKEN_OR ? 1 : 0), lhsBB);
+            phi->addIncoming(r, rhsEnd);
+            return phi;
+        }
+        if (!isComparisonOp(op)) break;
+        SlotKind opKind;
+        if (binaryIsNumeric(cg, node, &opKind)) return codegenNumericCmp(cg, node, opKind);
+        llvm::Value* lhs = codegenExpr(cg, node->as.binary.left);
+        llvm::Value* rhs = codegenExpr(cg, node->as.binary.right);
+        if (!knownNonNumeric(llvm_infer_expr_type(cg, node->as.binary.left)) &&
+            !knownNonNumeric(llvm_infer_expr_type(cg, node->as.binary.right)))
+            return emitTagCheckedBinary(cg, op, rtNameForBinary(op), lhs, rhs, true);
+        /* rt_eq & co. always return a bool */
+        return cg.unboxBool(cg.callRT(rtNameForBinary(op), {lhs, rhs}));
+    }
+    case NODE_CALL: {
+        const FuncSigInfo* sig = nativeSigFor(cg, node);
+        if (sig && sig->ret_kind == SLOT_BOOL) return emitNativeCall(cg, node, *sig);
+        break;
+    }
+    default:
+        break;
+    }
+    llvm::Value* v = codegenExpr(cg, node);
+    if (isKnownBool(cg, node)) return cg.unboxBool(v);
+    return cg.isTruthy(v);
+}
+
+/* Evaluate `node` in a native signature representation (raw i64/double/i1) */
+static llvm::Value* codegenRaw(Codegen& cg, ASTNode* node, SlotKind k) {
+    if (k != SLOT_BOOL) return codegenNumeric(cg, node, k);
+    if ((node->type == NODE_BINARY && isComparisonOp(node->as.binary.op)) || node->type == NODE_CALL)
+        return codegenCond(cg, node);
+    return cg.coerceToSlot(SLOT_BOOL, codegenExpr(cg, node));
+}
+
+/* True if codegenExpr's NODE_CALL handles `name` as a built-in before
+ * looking at user functions (keep in sync with that list) */
+static bool isBuiltinCall(const char* name, int argc) {
+    static const char* const always[] = {
+        "print", "input", "len", "range", "type", "append",
+        "getCurrentTime", "getProcessMemory", "getVmMemory", "getVmPeakMemory",
+    };
+    static const char* const withArg[] = {
+        "toSeconds", "toMilliseconds", "toMinutes", "toHours",
+        "bytesToKB", "bytesToMB", "bytesToGB",
+    };
+    for (const char* b : always)
+        if (strcmp(name, b) == 0) return true;
+    if (argc > 0)
+        for (const char* b : withArg)
+            if (strcmp(name, b) == 0) return true;
+    return false;
+}
+
+/* The signature of a call's target when it can be called natively.
+ * Built-in names win over user functions, as they do in codegenExpr. */
+static const FuncSigInfo* nativeSigFor(Codegen& cg, ASTNode* call) {
+    if (call->as.call.callee->type != NODE_IDENTIFIER) return nullptr;
+    if (isBuiltinCall(call->as.call.callee->as.identifier.name, call->as.call.arg_count)) return nullptr;
+    auto it = cg.funcSigs.find(call->as.call.callee->as.identifier.name);
+    if (it == cg.funcSigs.end() || !it->second.native) return nullptr;
+    if (call->as.call.arg_count != it->second.param_count) return nullptr;
+    return &it->second;
+}
+
+/* Call the raw-typed body directly; the result is in sig.ret_kind form */
+static llvm::Value* emitNativeCall(Codegen& cg, ASTNode* call, const FuncSigInfo& sig) {
+    std::vector<llvm::Value*> args;
+    for (int i = 0; i < sig.param_count; i++)
+        args.push_back(codegenRaw(cg, call->as.call.args[i], sig.param_kinds[i]));
+    return cg.B->CreateCall(sig.native, args);
+}
+
+/* ── String concatenation chains ── */
+
+static bool knownString(Codegen& cg, ASTNode* node) {
+    if (node->type == NODE_STRING_LIT) return true;
+    if (cg.mode == MODE_DYNAMIC) return false;
+    const char* t = llvm_infer_expr_type(cg, node);
+    return t && strcmp(t, "string") == 0;
+}
+
+/* `+` is left-associative, so once one operand of the left spine
+ * o0 + o1 + ... + on is a string, every `+` above it concatenates.
+ * Fills `parts` with the operands from there on, the sum of everything
+ * below as the first part; false if no operand is known to be a string. */
+static bool concatChain(Codegen& cg, ASTNode* node, std::vector<ASTNode*>& parts) {
+    std::vector<ASTNode*> spine;   /* top-down */
+    for (ASTNode* n = node; n->type == NODE_BINARY && n->as.binary.op == TOKEN_PLUS; n = n->as.binary.left)
+        spine.push_back(n);
+    int n = (int)spine.size();
+    auto operand = [&](int i) { return i == 0 ? spine[n - 1]->as.binary.left : spine[n - i]->as.binary.right; };
+    int first = -1;
+    for (int i = 0; i <= n && first < 0; i++)
+        if (knownString(cg, operand(i))) first = i;
+    if (first < 0) return false;
+    if (first == 0) first = 1;
+    parts.push_back(first == 1 ? operand(0) : spine[n - first + 1]);
+    for (int i = first; i <= n; i++) parts.push_back(operand(i));
+    return true;
+}
+
+/* Adjacent string literals are joined at compile time; the rest are
+ * evaluated left to right and joined by rt_concat in one allocation. */
+static llvm::Value* emitConcat(Codegen& cg, const std::vector<ASTNode*>& parts) {
+    std::vector<llvm::Value*> vals;
+    std::string lit;
+    bool pending = false;
+    for (ASTNode* p : parts) {
+        if (p->type == NODE_STRING_LIT) { lit += literalText(p); pending = true; continue; }
+        if (pending) { vals.push_back(cg.makeStaticString(lit)); lit.clear(); pending = false; }
+        vals.push_back(codegenExpr(cg, p));
+    }
+    if (pending) vals.push_back(cg.makeStaticString(lit));
+    llvm::AllocaInst* arr = cg.scratchArray((int)vals.size(), "concat_parts");
+    for (size_t i = 0; i < vals.size(); i++)
+        cg.storeSlot(vals[i], cg.B->CreateGEP(cg.i64Ty, arr, {cg.i32Val((int)i)}));
+    return cg.callRT("rt_concat", {arr, cg.i32Val((int)vals.size())});
+}
+
+/* What print() shows for a literal argument, known at compile time */
+static bool printLiteralText(ASTNode* node, std::string* out) {
+    switch (node->type) {
+    case NODE_STRING_LIT: *out = literalText(node); return true;
+    case NODE_INT_LIT: {  /* as the boxed 48-bit value rt_print_int would get */
+        int64_t v = (int64_t)((uint64_t)node->as.int_literal << 16) >> 16;
+        *out = std::to_string((long long)v);
+        return true;
+    }
+    case NODE_BOOL_LIT:   *out = node->as.bool_literal ? "true" : "false"; return true;
+    case NODE_NULL_LIT:   *out = "null"; return true;
+    case NODE_FLOAT_LIT: {
+        char buf[NUM_BUF_SIZE];
+        num_format_print(node->as.float_literal, buf);
+        *out = buf;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/* print(a, b, ...) as typed runtime calls.  All arguments are evaluated
+ * first, as for rt_print; literal arguments, the separating spaces and
+ * the newline are merged into constant runs for rt_print_str, and values
+ * statically known to be int/float are printed raw. */
+static void emitPrint(Codegen& cg, ASTNode* call) {
+    struct Piece { std::string text; SlotKind kind; llvm::Value* v; };
+    std::vector<Piece> pieces;
+    auto addText = [&](const std::string& t) {
+        if (!pieces.empty() && !pieces.back().v) pieces.back().text += t;
+        else pieces.push_back({t, SLOT_BOXED, nullptr});
+    };
+    for (int i = 0; i < call->as.call.arg_count; i++) {
+        ASTNode* arg = call->as.call.args[i];
+        if (i > 0) addText(" ");
+        std::string lit;
+        if (printLiteralText(arg, &lit)) { addText(lit); continue; }
+        SlotKind k = (cg.mode == MODE_DYNAMIC) ? SLOT_BOXED : numericKind(llvm_infer_expr_type(cg, arg));
+        /* A boxed typed function may still return null; print what it returns */
+        if (arg->type == NODE_CALL && arg->as.call.callee->type == NODE_IDENTIFIER &&
+            cg.userFuncs.count(arg->as.call.callee->as.identifier.name) && !nativeSigFor(cg, arg))
+            k = SLOT_BOXED;
+        llvm::Value* v = (k == SLOT_BOXED) ? codegenExpr(cg, arg) : codegenNumeric(cg, arg, k);
+        pieces.push_back({"", k, v});
+    }
+    addText("\n");
+    for (const Piece& p : pieces) {
+        if (!p.v)
+            cg.callRT("rt_print_str", {cg.makeStringConstant(p.text), cg.i32Val((int)p.text.size())});
+        else if (p.kind == SLOT_INT)   /* wrapped to the 48-bit payload a boxed int keeps */
+            cg.callRT("rt_print_int", {cg.B->CreateAShr(cg.B->CreateShl(p.v, 16), 16)});
+        else if (p.kind == SLOT_FLOAT)
+            cg.callRT("rt_print_f64", {p.v});
+        else
+            cg.callRT("rt_print_val", {p.v});
+    }
+}
+
 /* ══════════════════════════════════════════════════════════════════
  *  Escape Analysis (ported from compiler.cpp)
  *  Walks the AST to determine if a named variable escapes its scope.
@@ -281,91 +1363,683 @@ static void llvm_analyze_escape(ASTNode* node, const char* target_name, int loop
         if (node->as.index_assign.index) llvm_analyze_escape(node->as.index_assign.index, target_name, loop_depth, result);
         break;
     }
-    case NODE_FREE: {
-        if (node->as.child && node->as.child->type == NODE_IDENTIFIER) {
-            if (strcmp(node->as.child->as.identifier.name, target_name) == 0) {
-                if (loop_depth > 0) result->escaped = true;
-                else {
-                    result->use_count++;
-                    result->has_manual_free = true;
-                }
-                return;
-            }
+    case NODE_FREE: {
+        if (node->as.child && node->as.child->type == NODE_IDENTIFIER) {
+            if (strcmp(node->as.child->as.identifier.name, target_name) == 0) {
+                if (loop_depth > 0) result->escaped = true;
+                else {
+                    result->use_count++;
+                    result->has_manual_free = true;
+                }
+                return;
+            }
+        }
+        llvm_analyze_escape(node->as.child, target_name, loop_depth, result);
+        break;
+    }
+    case NODE_BLOCK: {
+        for (int i = 0; i < node->as.block.count; i++)
+            llvm_analyze_escape(node->as.block.nodes[i], target_name, loop_depth, result);
+        break;
+    }
+    case NODE_IF: {
+        llvm_analyze_escape(node->as.if_stmt.cond, target_name, loop_depth, result);
+        llvm_analyze_escape(node->as.if_stmt.then_b, target_name, loop_depth + 1, result);
+        if (node->as.if_stmt.else_b) llvm_analyze_escape(node->as.if_stmt.else_b, target_name, loop_depth + 1, result);
+        break;
+    }
+    case NODE_WHILE: {
+        llvm_analyze_escape(node->as.while_stmt.cond, target_name, loop_depth, result);
+        llvm_analyze_escape(node->as.while_stmt.body, target_name, loop_depth + 1, result);
+        break;
+    }
+    case NODE_FOR_IN: {
+        llvm_analyze_escape(node->as.for_in.iterable, target_name, loop_depth, result);
+        llvm_analyze_escape(node->as.for_in.body, target_name, loop_depth + 1, result);
+        break;
+    }
+    case NODE_BINARY:
+        llvm_analyze_escape(node->as.binary.left, target_name, loop_depth, result);
+        llvm_analyze_escape(node->as.binary.right, target_name, loop_depth, result);
+        break;
+    case NODE_UNARY:
+        if (node->as.unary.op != TOKEN_STAR)
+            llvm_analyze_escape(node->as.unary.operand, target_name, loop_depth, result);
+        break;
+    case NODE_INDEX:
+        llvm_analyze_escape(node->as.index_access.object, target_name, loop_depth, result);
+        llvm_analyze_escape(node->as.index_access.index, target_name, loop_depth, result);
+        break;
+    case NODE_POSTFIX:
+        llvm_analyze_escape(node->as.postfix.operand, target_name, loop_depth, result);
+        break;
+    case NODE_ALLOC:
+        llvm_analyze_escape(node->as.alloc_expr.init, target_name, loop_depth, result);
+        break;
+    case NODE_LIST_LIT:
+        for (int i = 0; i < node->as.list_literal.count; i++)
+            llvm_analyze_escape(node->as.list_literal.nodes[i], target_name, loop_depth, result);
+        break;
+    case NODE_MAP_LIT:
+        for (int i = 0; i < node->as.map_literal.count; i++) {
+            llvm_analyze_escape(node->as.map_literal.keys[i], target_name, loop_depth, result);
+            llvm_analyze_escape(node->as.map_literal.values[i], target_name, loop_depth, result);
+        }
+        break;
+    case NODE_TRY_CATCH:
+        llvm_analyze_escape(node->as.try_catch.try_body, target_name, loop_depth + 1, result);
+        llvm_analyze_escape(node->as.try_catch.catch_body, target_name, loop_depth + 1, result);
+        break;
+    default:
+        break;
+    }
+
+    if (result->use_count > (result->has_manual_free ? 2 : 1)) {
+        result->escaped = true;
+    }
+}
+
+/* An int literal switch case, including a negated one */
+static bool switchIntLiteral(ASTNode* node, int64_t* out) {
+    if (node->type == NODE_INT_LIT) { *out = node->as.int_literal; return true; }
+    if (node->type == NODE_UNARY && node->as.unary.op == TOKEN_MINUS &&
+        node->as.unary.operand->type == NODE_INT_LIT) {
+        *out = -node->as.unary.operand->as.int_literal;
+        return true;
+    }
+    return false;
+}
+
+/* True if `node` contains a plain assignment (or redeclaration) of `name`.
+ * Used to decide whether a loop variable can stay in a raw int slot. */
+static bool llvm_assigns_name(ASTNode* node, const char* name) {
+    if (!node) return false;
+    switch (node->type) {
+    case NODE_ASSIGN:
+        return strcmp(node->as.assign.name, name) == 0 || llvm_assigns_name(node->as.assign.value, name);
+    case NODE_VAR_DECL:
+        return strcmp(node->as.var_decl.name, name) == 0 || llvm_assigns_name(node->as.var_decl.init, name);
+    case NODE_FOR_IN:
+        return strcmp(node->as.for_in.var_name, name) == 0 ||
+               llvm_assigns_name(node->as.for_in.iterable, name) || llvm_assigns_name(node->as.for_in.body, name);
+    case NODE_UNARY:   return llvm_assigns_name(node->as.unary.operand, name);
+    case NODE_POSTFIX: return llvm_assigns_name(node->as.postfix.operand, name);
+    case NODE_BINARY:
+        return llvm_assigns_name(node->as.binary.left, name) || llvm_assigns_name(node->as.binary.right, name);
+    case NODE_CALL:
+        for (int i = 0; i < node->as.call.arg_count; i++)
+            if (llvm_assigns_name(node->as.call.args[i], name)) return true;
+        return llvm_assigns_name(node->as.call.callee, name);
+    case NODE_INDEX:
+        return llvm_assigns_name(node->as.index_access.object, name) ||
+               llvm_assigns_name(node->as.index_access.index, name);
+    case NODE_INDEX_ASSIGN:
+        return llvm_assigns_name(node->as.index_assign.object, name) ||
+               llvm_assigns_name(node->as.index_assign.index, name) ||
+               llvm_assigns_name(node->as.index_assign.value, name);
+    case NODE_ALLOC: return llvm_assigns_name(node->as.alloc_expr.init, name);
+    case NODE_LIST_LIT:
+        for (int i = 0; i < node->as.list_literal.count; i++)
+            if (llvm_assigns_name(node->as.list_literal.nodes[i], name)) return true;
+        return false;
+    case NODE_MAP_LIT:
+        for (int i = 0; i < node->as.map_literal.count; i++)
+            if (llvm_assigns_name(node->as.map_literal.keys[i], name) ||
+                llvm_assigns_name(node->as.map_literal.values[i], name)) return true;
+        return false;
+    case NODE_EXPR_STMT: case NODE_RETURN: case NODE_THROW: case NODE_FREE:
+        return llvm_assigns_name(node->as.child, name);
+    case NODE_BLOCK:
+        for (int i = 0; i < node->as.block.count; i++)
+            if (llvm_assigns_name(node->as.block.nodes[i], name)) return true;
+        return false;
+    case NODE_IF:
+        return llvm_assigns_name(node->as.if_stmt.cond, name) ||
+               llvm_assigns_name(node->as.if_stmt.then_b, name) ||
+               llvm_assigns_name(node->as.if_stmt.else_b, name);
+    case NODE_WHILE:
+        return llvm_assigns_name(node->as.while_stmt.cond, name) || llvm_assigns_name(node->as.while_stmt.body, name);
+    case NODE_TRY_CATCH:
+        if (node->as.try_catch.err_var && strcmp(node->as.try_catch.err_var, name) == 0) return true;
+        return llvm_assigns_name(node->as.try_catch.try_body, name) ||
+               llvm_assigns_name(node->as.try_catch.catch_body, name);
+    case NODE_SWITCH:
+        if (llvm_assigns_name(node->as.switch_stmt.subject, name)) return true;
+        for (int i = 0; i < node->as.switch_stmt.case_count; i++)
+            if (llvm_assigns_name(node->as.switch_stmt.case_values[i], name) ||
+                llvm_assigns_name(node->as.switch_stmt.case_bodies[i], name)) return true;
+        return false;
+    default:
+        return false;
+    }
+}
+
+/* ══════════════════════════════════════════════════════════════════
+ *  Flow-sensitive type inference
+ *  Untyped variables (implicit globals, untyped params) have no declared
+ *  type, but most of them only ever hold one kind of value.  A forward
+ *  dataflow pass over each function body tracks what every such variable
+ *  holds at each read, joining at if/switch merges and iterating loops to
+ *  a fixpoint.  Reads with a single known type land in cg.flowTypes,
+ *  which llvm_infer_expr_type consults, so the typed fast paths cover
+ *  them too.
+ *
+ *  Only facts the generated code guarantees are used: literals, operator
+ *  results, raw int/float params and native returns.  Globals can be
+ *  reassigned by any callee, so a call to a user function forgets every
+ *  global that function may (transitively) assign.
+ * ══════════════════════════════════════════════════════════════════ */
+
+enum FlowType { FLOW_UNKNOWN, FLOW_INT, FLOW_FLOAT, FLOW_BOOL, FLOW_STRING, FLOW_LIST, FLOW_MAP };
+
+static const char* flowTypeName(FlowType t) {
+    switch (t) {
+    case FLOW_INT:    return "int";
+    case FLOW_FLOAT:  return "float";
+    case FLOW_BOOL:   return "bool";
+    case FLOW_STRING: return "string";
+    case FLOW_LIST:   return "list";
+    case FLOW_MAP:    return "map";
+    default:          return nullptr;
+    }
+}
+
+static FlowType flowTypeOfSlot(SlotKind k) {
+    if (k == SLOT_INT)   return FLOW_INT;
+    if (k == SLOT_FLOAT) return FLOW_FLOAT;
+    if (k == SLOT_BOOL)  return FLOW_BOOL;
+    return FLOW_UNKNOWN;
+}
+
+/* Variable types at one program point.  Absent names are unknown; an
+ * unreachable state (after return/break/...) is the identity for join. */
+struct FlowState {
+    bool reachable = true;
+    std::map<std::string, FlowType> vars;
+
+    FlowType get(const std::string& name) const {
+        auto it = vars.find(name);
+        return it == vars.end() ? FLOW_UNKNOWN : it->second;
+    }
+    void set(const std::string& name, FlowType t) {
+        if (t == FLOW_UNKNOWN) vars.erase(name);
+        else vars[name] = t;
+    }
+    void kill() { reachable = false; vars.clear(); }
+    void join(const FlowState& o) {
+        if (!o.reachable) return;
+        if (!reachable) { *this = o; return; }
+        for (auto it = vars.begin(); it != vars.end();) {
+            if (o.get(it->first) != it->second) it = vars.erase(it);
+            else ++it;
+        }
+    }
+    bool operator==(const FlowState& o) const { return reachable == o.reachable && vars == o.vars; }
+};
+
+static FlowState flowUnreachable() { FlowState s; s.kill(); return s; }
+
+/* Call `fn` on each direct child of `node` */
+template <typename F>
+static void forEachChild(ASTNode* node, F&& fn) {
+    auto visit = [&](ASTNode* c) { if (c) fn(c); };
+    switch (node->type) {
+    case NODE_LIST_LIT:
+        for (int i = 0; i < node->as.list_literal.count; i++) visit(node->as.list_literal.nodes[i]);
+        break;
+    case NODE_MAP_LIT:
+        for (int i = 0; i < node->as.map_literal.count; i++) {
+            visit(node->as.map_literal.keys[i]);
+            visit(node->as.map_literal.values[i]);
+        }
+        break;
+    case NODE_UNARY:   visit(node->as.unary.operand); break;
+    case NODE_POSTFIX: visit(node->as.postfix.operand); break;
+    case NODE_BINARY:  visit(node->as.binary.left); visit(node->as.binary.right); break;
+    case NODE_ASSIGN:  visit(node->as.assign.value); break;
+    case NODE_CALL:
+        visit(node->as.call.callee);
+        for (int i = 0; i < node->as.call.arg_count; i++) visit(node->as.call.args[i]);
+        break;
+    case NODE_INDEX:   visit(node->as.index_access.object); visit(node->as.index_access.index); break;
+    case NODE_INDEX_ASSIGN:
+        visit(node->as.index_assign.object);
+        visit(node->as.index_assign.index);
+        visit(node->as.index_assign.value);
+        break;
+    case NODE_ALLOC:    visit(node->as.alloc_expr.init); break;
+    case NODE_VAR_DECL: visit(node->as.var_decl.init); break;
+    case NODE_BLOCK:
+        for (int i = 0; i < node->as.block.count; i++) visit(node->as.block.nodes[i]);
+        break;
+    case NODE_IF:
+        visit(node->as.if_stmt.cond); visit(node->as.if_stmt.then_b); visit(node->as.if_stmt.else_b);
+        break;
+    case NODE_WHILE:  visit(node->as.while_stmt.cond); visit(node->as.while_stmt.body); break;
+    case NODE_FOR_IN: visit(node->as.for_in.iterable); visit(node->as.for_in.body); break;
+    case NODE_FUNC_DECL: visit(node->as.func_decl.body); break;
+    case NODE_EXPR_STMT: case NODE_RETURN: case NODE_THROW: case NODE_FREE:
+        visit(node->as.child);
+        break;
+    case NODE_TRY_CATCH: visit(node->as.try_catch.try_body); visit(node->as.try_catch.catch_body); break;
+    case NODE_SWITCH:
+        visit(node->as.switch_stmt.subject);
+        for (int i = 0; i < node->as.switch_stmt.case_count; i++) {
+            visit(node->as.switch_stmt.case_values[i]);
+            visit(node->as.switch_stmt.case_bodies[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Collection counterpart of llvm_analyze_escape: a list/map local stays
+ * put if `name` only ever appears as the container of an index read or
+ * write, as the iterable of a for-in, as the list of an append(), or as
+ * a len()/print()/type() argument.
+ * Anything else (including reassignment or shadowing) counts as escaping. */
+static bool llvm_collection_escapes(ASTNode* node, const char* name) {
+    if (!node) return false;
+    auto isName = [&](ASTNode* n) { return n->type == NODE_IDENTIFIER && strcmp(n->as.identifier.name, name) == 0; };
+    switch (node->type) {
+    case NODE_IDENTIFIER:
+        return isName(node);
+    case NODE_ASSIGN:
+        if (strcmp(node->as.assign.name, name) == 0) return true;
+        break;
+    case NODE_VAR_DECL:
+        if (strcmp(node->as.var_decl.name, name) == 0) return true;
+        break;
+    case NODE_FOR_IN:
+        if (strcmp(node->as.for_in.var_name, name) == 0) return true;
+        if (isName(node->as.for_in.iterable)) return llvm_collection_escapes(node->as.for_in.body, name);
+        break;
+    case NODE_TRY_CATCH:
+        if (node->as.try_catch.err_var && strcmp(node->as.try_catch.err_var, name) == 0) return true;
+        break;
+    case NODE_INDEX:
+        if (isName(node->as.index_access.object))
+            return llvm_collection_escapes(node->as.index_access.index, name);
+        break;
+    case NODE_INDEX_ASSIGN:
+        if (node->as.index_assign.index && isName(node->as.index_assign.object))
+            return llvm_collection_escapes(node->as.index_assign.index, name) ||
+                   llvm_collection_escapes(node->as.index_assign.value, name);
+        break;
+    case NODE_CALL: {
+        ASTNode* callee = node->as.call.callee;
+        if (callee->type != NODE_IDENTIFIER) break;
+        const char* fn = callee->as.identifier.name;
+        bool reads = strcmp(fn, "len") == 0 || strcmp(fn, "print") == 0 || strcmp(fn, "type") == 0;
+        if (reads || strcmp(fn, "append") == 0) {
+            for (int i = 0; i < node->as.call.arg_count; i++) {
+                ASTNode* a = node->as.call.args[i];
+                if ((reads || i == 0) && isName(a)) continue;
+                if (llvm_collection_escapes(a, name)) return true;
+            }
+            return false;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    bool escapes = false;
+    forEachChild(node, [&](ASTNode* c) { escapes = escapes || llvm_collection_escapes(c, name); });
+    return escapes;
+}
+
+/* Largest list/map literal that gets stack storage */
+#define STACK_COLLECTION_MAX 16
+
+/* Bytes of entry-block storage for the local declared by block statement
+ * `i`, or 0 if it has to stay on the heap.  Pointers qualify in exactly
+ * the case the block would free them at scope exit anyway (one use, no
+ * manual free), so leak and auto-free reports are unchanged. */
+static size_t llvm_local_storage_size(Codegen& cg, ASTNode* block, int i) {
+    ASTNode* decl = block->as.block.nodes[i];
+    if (decl->type != NODE_VAR_DECL) return 0;
+    const char* name = decl->as.var_decl.name;
+    const char* tn = decl->as.var_decl.type_name;
+    ASTNode* init = decl->as.var_decl.init;
+
+    if (init && init->type == NODE_ALLOC) {
+        if (!cg.autofree_enabled) return 0;
+        LLVMEscapeResult er = {false, false, 0, true};
+        for (int j = i + 1; j < block->as.block.count && !er.escaped; j++)
+            llvm_analyze_escape(block->as.block.nodes[j], name, 0, &er);
+        if (er.escaped || er.has_manual_free || er.use_count != 1) return 0;
+        return sizeof(ObjPointer) + sizeof(Value);
+    }
+
+    bool isList = tn && strcmp(tn, "list") == 0;
+    bool isMap  = tn && strcmp(tn, "map") == 0;
+    if (!isList && !isMap) return 0;
+    int count = 0;
+    if (init) {
+        if (init->type != (isList ? NODE_LIST_LIT : NODE_MAP_LIT)) return 0;
+        count = isList ? init->as.list_literal.count : init->as.map_literal.count;
+    }
+    if (count > STACK_COLLECTION_MAX) return 0;
+    for (int j = i + 1; j < block->as.block.count; j++)
+        if (llvm_collection_escapes(block->as.block.nodes[j], name)) return 0;
+    return (isList ? sizeof(ObjList) : sizeof(ObjMap)) + sizeof(Value) * count;
+}
+
+/* Names a function body assigns, functions it calls, and names it
+ * declares in a nested scope (typed locals, loop and catch variables) */
+struct FlowFuncInfo {
+    std::set<std::string> writes;
+    std::set<std::string> callees;
+    std::set<std::string> scoped;
+};
+
+static void flowCollect(ASTNode* node, FlowFuncInfo& info) {
+    switch (node->type) {
+    case NODE_ASSIGN: info.writes.insert(node->as.assign.name); break;
+    case NODE_POSTFIX:
+        if (node->as.postfix.operand->type == NODE_IDENTIFIER)
+            info.writes.insert(node->as.postfix.operand->as.identifier.name);
+        break;
+    case NODE_CALL:
+        if (node->as.call.callee->type == NODE_IDENTIFIER)
+            info.callees.insert(node->as.call.callee->as.identifier.name);
+        break;
+    case NODE_VAR_DECL: info.scoped.insert(node->as.var_decl.name); break;
+    case NODE_FOR_IN:   info.scoped.insert(node->as.for_in.var_name); break;
+    case NODE_TRY_CATCH:
+        if (node->as.try_catch.err_var) info.scoped.insert(node->as.try_catch.err_var);
+        break;
+    default:
+        break;
+    }
+    forEachChild(node, [&](ASTNode* c) { flowCollect(c, info); });
+}
+
+struct FlowInfer {
+    Codegen& cg;
+    const std::map<std::string, std::set<std::string>>& clobbers;  /* function → globals it may assign */
+    std::map<std::string, FlowType> declared;   /* typed params */
+    std::set<std::string> scoped;               /* may shadow a global: never tracked */
+    struct Target { FlowState* brk; FlowState* cont; };
+    std::vector<Target> targets;                /* innermost loop/switch last */
+    FlowState st;
+
+    FlowInfer(Codegen& cg, const std::map<std::string, std::set<std::string>>& clobbers)
+        : cg(cg), clobbers(clobbers) {}
+
+    bool tracked(const std::string& name) const { return !scoped.count(name) && !declared.count(name); }
+
+    FlowType read(ASTNode* id) {
+        const char* name = id->as.identifier.name;
+        if (scoped.count(name)) return FLOW_UNKNOWN;
+        auto d = declared.find(name);
+        if (d != declared.end()) return d->second;
+        FlowType t = st.get(name);
+        if (t != FLOW_UNKNOWN) cg.flowTypes[id] = flowTypeName(t);
+        else cg.flowTypes.erase(id);    /* a later loop iteration may widen it */
+        return t;
+    }
+
+    void write(const char* name, FlowType t) { if (tracked(name)) st.set(name, t); }
+
+    FlowType expr(ASTNode* n);
+    void stmt(ASTNode* n);
+    void loop(ASTNode* cond, ASTNode* body);
+};
+
+FlowType FlowInfer::expr(ASTNode* n) {
+    if (!n) return FLOW_UNKNOWN;
+    switch (n->type) {
+    case NODE_INT_LIT:    return FLOW_INT;
+    case NODE_FLOAT_LIT:  return FLOW_FLOAT;
+    case NODE_BOOL_LIT:   return FLOW_BOOL;
+    case NODE_STRING_LIT: return FLOW_STRING;
+    case NODE_LIST_LIT:
+        forEachChild(n, [&](ASTNode* c) { expr(c); });
+        return FLOW_LIST;
+    case NODE_MAP_LIT:
+        forEachChild(n, [&](ASTNode* c) { expr(c); });
+        return FLOW_MAP;
+    case NODE_IDENTIFIER:
+        return read(n);
+    case NODE_UNARY: {
+        FlowType t = expr(n->as.unary.operand);
+        if (n->as.unary.op == TOKEN_BANG) return FLOW_BOOL;    /* rt_not rejects non-bools */
+        if (n->as.unary.op == TOKEN_MINUS && (t == FLOW_INT || t == FLOW_FLOAT)) return t;
+        return FLOW_UNKNOWN;
+    }
+    case NODE_BINARY: {
+        TokenType op = n->as.binary.op;
+        if (op == TOKEN_AND || op == TOKEN_OR) {
+            /* The right operand may be skipped, and the result is an operand */
+            FlowType l = expr(n->as.binary.left);
+            FlowState skipped = st;
+            FlowType r = expr(n->as.binary.right);
+            st.join(skipped);
+            return (l == FLOW_BOOL && r == FLOW_BOOL) ? FLOW_BOOL : FLOW_UNKNOWN;
+        }
+        FlowType l = expr(n->as.binary.left);
+        FlowType r = expr(n->as.binary.right);
+        if (isComparisonOp(op)) return FLOW_BOOL;
+        if (op == TOKEN_PLUS && (l == FLOW_STRING || r == FLOW_STRING)) return FLOW_STRING;
+        bool lnum = (l == FLOW_INT || l == FLOW_FLOAT), rnum = (r == FLOW_INT || r == FLOW_FLOAT);
+        if (!lnum || !rnum) return FLOW_UNKNOWN;
+        switch (op) {
+        case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_STAR: case TOKEN_SLASH:
+            return (l == FLOW_FLOAT || r == FLOW_FLOAT) ? FLOW_FLOAT : FLOW_INT;
+        case TOKEN_PERCENT:
+            return (l == FLOW_INT && r == FLOW_INT) ? FLOW_INT : FLOW_UNKNOWN;
+        default:
+            return FLOW_UNKNOWN;
+        }
+    }
+    case NODE_ASSIGN: {
+        FlowType t = expr(n->as.assign.value);
+        write(n->as.assign.name, t);
+        return t;
+    }
+    case NODE_POSTFIX: {
+        ASTNode* operand = n->as.postfix.operand;
+        if (operand->type != NODE_IDENTIFIER) return FLOW_UNKNOWN;
+        FlowType t = read(operand);
+        write(operand->as.identifier.name, (t == FLOW_INT || t == FLOW_FLOAT) ? t : FLOW_UNKNOWN);
+        return t;
+    }
+    case NODE_CALL: {
+        forEachChild(n, [&](ASTNode* c) { expr(c); });
+        if (n->as.call.callee->type != NODE_IDENTIFIER) return FLOW_UNKNOWN;
+        const char* fname = n->as.call.callee->as.identifier.name;
+        auto cl = clobbers.find(fname);
+        if (cl != clobbers.end())
+            for (auto& g : cl->second) st.set(g, FLOW_UNKNOWN);
+        if (cg.userFuncs.count(fname)) {
+            /* Only native returns are coerced to their declared type */
+            auto sig = cg.funcSigs.find(fname);
+            return (sig != cg.funcSigs.end() && sig->second.native) ? flowTypeOfSlot(sig->second.ret_kind)
+                                                                   : FLOW_UNKNOWN;
+        }
+        if (strcmp(fname, "len") == 0) return FLOW_INT;
+        return FLOW_UNKNOWN;
+    }
+    default:
+        /* INDEX, INDEX_ASSIGN, ALLOC, null: evaluate operands, result unknown */
+        forEachChild(n, [&](ASTNode* c) { expr(c); });
+        return FLOW_UNKNOWN;
+    }
+}
+
+/* A loop header is re-entered from the end of the body and from
+ * `continue`; iterate until its state stops changing.  Types only ever
+ * widen to unknown, so this terminates.  `cond` runs at the header. */
+void FlowInfer::loop(ASTNode* cond, ASTNode* body) {
+    FlowState entry = st, header = st;
+    for (;;) {
+        st = header;
+        expr(cond);
+        FlowState exit = st;
+        FlowState brk = flowUnreachable(), cont = flowUnreachable();
+        targets.push_back({&brk, &cont});
+        stmt(body);
+        targets.pop_back();
+        FlowState next = entry;
+        next.join(st);
+        next.join(cont);
+        if (next == header) {
+            exit.join(brk);
+            st = exit;
+            return;
         }
-        llvm_analyze_escape(node->as.child, target_name, loop_depth, result);
-        break;
+        header = next;
     }
-    case NODE_BLOCK: {
-        for (int i = 0; i < node->as.block.count; i++)
-            llvm_analyze_escape(node->as.block.nodes[i], target_name, loop_depth, result);
+}
+
+void FlowInfer::stmt(ASTNode* n) {
+    if (!n) return;
+    switch (n->type) {
+    case NODE_BLOCK:
+        for (int i = 0; i < n->as.block.count; i++) stmt(n->as.block.nodes[i]);
         break;
-    }
-    case NODE_IF: {
-        llvm_analyze_escape(node->as.if_stmt.cond, target_name, loop_depth, result);
-        llvm_analyze_escape(node->as.if_stmt.then_b, target_name, loop_depth + 1, result);
-        if (node->as.if_stmt.else_b) llvm_analyze_escape(node->as.if_stmt.else_b, target_name, loop_depth + 1, result);
+    case NODE_EXPR_STMT: case NODE_FREE:
+        expr(n->as.child);
         break;
-    }
-    case NODE_WHILE: {
-        llvm_analyze_escape(node->as.while_stmt.cond, target_name, loop_depth, result);
-        llvm_analyze_escape(node->as.while_stmt.body, target_name, loop_depth + 1, result);
+    case NODE_VAR_DECL:
+        expr(n->as.var_decl.init);
         break;
-    }
-    case NODE_FOR_IN: {
-        llvm_analyze_escape(node->as.for_in.iterable, target_name, loop_depth, result);
-        llvm_analyze_escape(node->as.for_in.body, target_name, loop_depth + 1, result);
+    case NODE_IF: {
+        expr(n->as.if_stmt.cond);
+        FlowState cond = st;
+        stmt(n->as.if_stmt.then_b);
+        FlowState then = st;
+        st = cond;
+        stmt(n->as.if_stmt.else_b);
+        st.join(then);
         break;
     }
-    case NODE_BINARY:
-        llvm_analyze_escape(node->as.binary.left, target_name, loop_depth, result);
-        llvm_analyze_escape(node->as.binary.right, target_name, loop_depth, result);
+    case NODE_WHILE:
+        loop(n->as.while_stmt.cond, n->as.while_stmt.body);
         break;
-    case NODE_UNARY:
-        if (node->as.unary.op != TOKEN_STAR)
-            llvm_analyze_escape(node->as.unary.operand, target_name, loop_depth, result);
+    case NODE_FOR_IN:
+        expr(n->as.for_in.iterable);
+        loop(nullptr, n->as.for_in.body);
         break;
-    case NODE_INDEX:
-        llvm_analyze_escape(node->as.index_access.object, target_name, loop_depth, result);
-        llvm_analyze_escape(node->as.index_access.index, target_name, loop_depth, result);
+    case NODE_RETURN: case NODE_THROW:
+        expr(n->as.child);
+        st.kill();
         break;
-    case NODE_POSTFIX:
-        llvm_analyze_escape(node->as.postfix.operand, target_name, loop_depth, result);
+    case NODE_BREAK:
+        if (!targets.empty()) { targets.back().brk->join(st); st.kill(); }
         break;
-    case NODE_ALLOC:
-        llvm_analyze_escape(node->as.alloc_expr.init, target_name, loop_depth, result);
+    case NODE_CONTINUE:
+        /* Like codegen, `continue` directly inside a switch is a no-op */
+        if (!targets.empty() && targets.back().cont) { targets.back().cont->join(st); st.kill(); }
         break;
-    case NODE_LIST_LIT:
-        for (int i = 0; i < node->as.list_literal.count; i++)
-            llvm_analyze_escape(node->as.list_literal.nodes[i], target_name, loop_depth, result);
+    case NODE_TRY_CATCH: {
+        bool reachable = st.reachable;
+        stmt(n->as.try_catch.try_body);
+        FlowState done = st;
+        /* The catch can be entered from any point in the try body */
+        st = FlowState();
+        if (!reachable) st.kill();
+        stmt(n->as.try_catch.catch_body);
+        st.join(done);
         break;
-    case NODE_MAP_LIT:
-        for (int i = 0; i < node->as.map_literal.count; i++) {
-            llvm_analyze_escape(node->as.map_literal.keys[i], target_name, loop_depth, result);
-            llvm_analyze_escape(node->as.map_literal.values[i], target_name, loop_depth, result);
+    }
+    case NODE_SWITCH: {
+        auto& sw = n->as.switch_stmt;
+        expr(sw.subject);
+        /* Case values are tested in order until one matches */
+        std::vector<FlowState> caseEntry(sw.case_count);
+        for (int i = 0; i < sw.case_count; i++) {
+            if (i != sw.default_idx) expr(sw.case_values[i]);
+            caseEntry[i] = st;
         }
+        FlowState noMatch = st;
+        FlowState brk = flowUnreachable(), out = flowUnreachable(), prev = flowUnreachable();
+        targets.push_back({&brk, nullptr});
+        /* Bodies run in source order with default last; in break mode
+         * each one falls through into the next */
+        auto body = [&](int i, const FlowState& in) {
+            st = in;
+            if (sw.break_mode) st.join(prev);
+            stmt(sw.case_bodies[i]);
+            if (sw.break_mode) prev = st;
+            else out.join(st);
+        };
+        for (int i = 0; i < sw.case_count; i++)
+            if (i != sw.default_idx) body(i, caseEntry[i]);
+        if (sw.default_idx >= 0) body(sw.default_idx, noMatch);
+        else out.join(noMatch);
+        targets.pop_back();
+        out.join(prev);
+        out.join(brk);
+        st = out;
         break;
-    case NODE_TRY_CATCH:
-        llvm_analyze_escape(node->as.try_catch.try_body, target_name, loop_depth + 1, result);
-        llvm_analyze_escape(node->as.try_catch.catch_body, target_name, loop_depth + 1, result);
-        break;
+    }
     default:
         break;
     }
+}
 
-    if (result->use_count > (result->has_manual_free ? 2 : 1)) {
-        result->escaped = true;
+/* Run the flow pass over every function; fills cg.flowTypes.  Runs after
+ * prescan so native signatures are known.  Top-level code needs no pass:
+ * outside functions only declarations are allowed (see compiler.cpp), so
+ * __tantrums_init has no untyped locals or loops and every global it
+ * reads or writes has a declared type. */
+static void inferFlowTypes(Codegen& cg, ASTNode* program) {
+    std::vector<ASTNode*> funcs;
+    std::map<std::string, FlowFuncInfo> infos;
+    for (int i = 0; i < program->as.program.count; i++) {
+        ASTNode* n = program->as.program.nodes[i];
+        if (n->type != NODE_FUNC_DECL) continue;
+        funcs.push_back(n);
+        flowCollect(n, infos[n->as.func_decl.name]);
+    }
+
+    /* Globals each function may assign, directly or through its callees */
+    std::map<std::string, std::set<std::string>> clobbers;
+    for (ASTNode* f : funcs) {
+        auto& w = clobbers[f->as.func_decl.name];
+        w.insert(infos[f->as.func_decl.name].writes.begin(), infos[f->as.func_decl.name].writes.end());
+        for (int p = 0; p < f->as.func_decl.param_count; p++) w.erase(f->as.func_decl.params[p].name);
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& kv : clobbers) {
+            for (auto& callee : infos[kv.first].callees) {
+                auto cl = clobbers.find(callee);
+                if (cl == clobbers.end() || cl == clobbers.find(kv.first)) continue;
+                for (auto& g : cl->second)
+                    if (kv.second.insert(g).second) changed = true;
+            }
+        }
+    }
+
+    for (ASTNode* f : funcs) {
+        FlowInfer fi(cg, clobbers);
+        fi.scoped = infos[f->as.func_decl.name].scoped;
+        for (int p = 0; p < f->as.func_decl.param_count; p++) {
+            const ParamDef& pd = f->as.func_decl.params[p];
+            if (pd.type_name) fi.declared[pd.name] = flowTypeOfSlot(cg.slotKindFor(pd.type_name));
+        }
+        fi.stmt(f->as.func_decl.body);
     }
 }
 
 /* Emit cleanup for all auto_free / auto_free_collection locals in a single scope layer */
 static void emitScopeCleanup(Codegen& cg, std::vector<LocalInfo>& locals) {
     for (auto& li : locals) {
+        if (li.stack_obj) {
+            if (li.stack_collection) cg.callRT("rt_local_release", {li.stack_obj});
+            continue;
+        }
         if (li.auto_free && cg.autofree_enabled) {
-            llvm::Value* val = cg.B->CreateLoad(cg.i64Ty, li.alloca, li.name.c_str());
+            llvm::Value* val = cg.loadSlot(cg.i64Ty, li.alloca, li.name.c_str());
             cg.callRT("rt_free_val", {val});
         }
         if (li.auto_free_collection && cg.autofree_enabled) {
-            llvm::Value* val = cg.B->CreateLoad(cg.i64Ty, li.alloca, li.name.c_str());
+            llvm::Value* val = cg.loadSlot(cg.i64Ty, li.alloca, li.name.c_str());
             cg.callRT("rt_free_collection", {val});
         }
     }
@@ -389,8 +2063,15 @@ static void declareRuntimeFunctions(Codegen& cg) {
     };
 
     decl("rt_print",       v,   {pi64, i32});
+    decl("rt_print_str",   v,   {p8, i32});
+    decl("rt_print_int",   v,   {i64});
+    decl("rt_print_f64",   v,   {cg.f64Ty});
+    decl("rt_print_val",   v,   {i64});
     decl("rt_string_from_cstr", i64, {p8});
+    decl("rt_concat",      i64, {pi64, i32});
     decl("rt_input",       i64, {i64});
+    decl("rt_string_hash", i64, {i64});
+    decl("rt_string_equals", i32, {i64, p8, i32});
     decl("rt_len",         i64, {i64});
     decl("rt_range",       i64, {i64, i64, i64});
     decl("rt_type",        i64, {i64});
@@ -398,6 +2079,9 @@ static void declareRuntimeFunctions(Codegen& cg) {
     decl("rt_map_new",     i64, {pi64, pi64, i32});
     decl("rt_index_get",   i64, {i64, i64});
     decl("rt_index_set",   v,   {i64, i64, i64});
+    decl("rt_map_new_shaped", i64, {p8, pi64, pi64, i32});
+    decl("rt_field_get",   i64, {i64, p8, i32, p8});
+    decl("rt_field_set",   v,   {i64, p8, i32, p8, i64});
     decl("rt_append",      v,   {i64, i64});
     decl("rt_alloc",       i64, {i64, p8, i32});
     decl("rt_free_val",    v,   {i64});
@@ -419,6 +2103,14 @@ static void declareRuntimeFunctions(Codegen& cg) {
     decl("rt_is_truthy",   i32, {i64});
     decl("rt_for_in_step", i64, {i64, pi64});
     decl("rt_for_in_has_next", i32, {i64, i64});
+    decl("rt_for_in_kind", i32, {i64});
+    decl("rt_list_count",  i64, {i64});
+    decl("rt_list_item",   i64, {i64, i64});
+    decl("rt_list_store",  v,   {i64, i64, i64});
+    decl("rt_map_get",     i64, {i64, i64});
+    decl("rt_map_set",     v,   {i64, i64, i64});
+    decl("rt_string_length", i64, {i64});
+    decl("rt_string_char", i64, {i64, i64});
     decl("rt_throw",       v,   {i64});
     decl("rt_try_push",    v,   {});
     decl("rt_try_exit",    v,   {});
@@ -433,6 +2125,11 @@ static void declareRuntimeFunctions(Codegen& cg) {
     decl("rt_exit_scope",  v,   {});
     decl("rt_mark_escaped",v,   {i64});
     decl("rt_free_collection", v, {i64});
+    /* Objects in caller-provided (entry-block) storage */
+    decl("rt_alloc_local",    i64, {p8, i64});
+    decl("rt_list_new_local", i64, {p8, pi64, i32});
+    decl("rt_map_new_local",  i64, {p8, p8, pi64, pi64, i32});
+    decl("rt_local_release",  v,   {p8});
     decl("rt_set_exe_path", v,   {p8});
     decl("rt_init",        v,   {i32, i32});
     decl("rt_shutdown",    v,   {});
@@ -477,12 +2174,67 @@ static void declareRuntimeFunctions(Codegen& cg) {
     decl("rt_filesystem_writelines",   i64, {i64, i64});
     decl("rt_filesystem_cwd",          i64, {});
     decl("rt_filesystem_abspath",      i64, {i64});
+
+    /* Effects from runtime.h.  callRT copies them onto each call site, so
+     * they survive the runtime bitcode replacing these declarations. */
+    static const struct { const char* name; unsigned fx; } effects[] = {
+#define RT_EFFECT_ENTRY(fn, fx) { #fn, fx },
+        RT_EFFECTS(RT_EFFECT_ENTRY)
+#undef RT_EFFECT_ENTRY
+    };
+    for (const auto& e : effects) {
+        llvm::Function* fn = M.getFunction(e.name);
+        if (!fn) { fprintf(stderr, "BUG: runtime function '%s' not declared\n", e.name); continue; }
+        if (e.fx & RT_NOTHROW) {
+            fn->setDoesNotThrow();
+            fn->setWillReturn();
+        }
+        if (e.fx & RT_READNONE)      fn->setDoesNotAccessMemory();
+        else if (e.fx & RT_READONLY) fn->setOnlyReadsMemory();
+        if (e.fx & RT_COLD) {
+            fn->addFnAttr(llvm::Attribute::Cold);
+            fn->setDoesNotReturn();
+        }
+        if (e.fx & RT_NOCAPTURE) {
+            for (llvm::Argument& a : fn->args())
+                if (a.getType()->isPointerTy())
+                    fn->addParamAttr(a.getArgNo(), llvm::Attribute::getWithCaptureInfo(cg.ctx, llvm::CaptureInfo::none()));
+        }
+    }
 }
 
 /* ══════════════════════════════════════════════════════════════════
  *  Prescan — forward-declare user functions
  * ══════════════════════════════════════════════════════════════════ */
 
+/* True if every path through `node` ends in `return <value>` or throw,
+ * so a native body never has to make up a value for falling off the end */
+static bool llvm_always_returns(ASTNode* node) {
+    if (!node) return false;
+    switch (node->type) {
+    case NODE_RETURN: return node->as.child != nullptr;
+    case NODE_THROW:  return true;
+    case NODE_BLOCK:
+        for (int i = 0; i < node->as.block.count; i++)
+            if (llvm_always_returns(node->as.block.nodes[i])) return true;
+        return false;
+    case NODE_IF:
+        return llvm_always_returns(node->as.if_stmt.then_b) && llvm_always_returns(node->as.if_stmt.else_b);
+    case NODE_TRY_CATCH:
+        return llvm_always_returns(node->as.try_catch.try_body) && llvm_always_returns(node->as.try_catch.catch_body);
+    default:
+        return false;
+    }
+}
+
+static bool llvm_has_bare_return(ASTNode* node) {
+    if (!node) return false;
+    if (node->type == NODE_RETURN && !node->as.child) return true;
+    bool found = false;
+    forEachChild(node, [&](ASTNode* c) { found = found || llvm_has_bare_return(c); });
+    return found;
+}
+
 static void prescan(Codegen& cg, ASTNode* program) {
     if (program->type != NODE_PROGRAM) return;
     for (int i = 0; i < program->as.program.count; i++) {
@@ -495,6 +2247,30 @@ static void prescan(Codegen& cg, ASTNode* program) {
         FuncSigInfo sig;
         sig.ret_type = n->as.func_decl.ret_type ? n->as.func_decl.ret_type : "";
         sig.param_count = arity;
+
+        /* Functions whose params and return are all int/float/bool also get
+         * a body on raw machine types; __t_ becomes a boxing wrapper.  A
+         * body that can end without a value keeps returning null, so it
+         * stays boxed. */
+        bool native = strcmp(name, "main") != 0 && llvm_always_returns(n->as.func_decl.body) &&
+                      !llvm_has_bare_return(n->as.func_decl.body);
+        sig.ret_kind = cg.sigKindFor(n->as.func_decl.ret_type);
+        if (sig.ret_kind == SLOT_BOXED) native = false;
+        for (int p = 0; p < arity && native; p++) {
+            SlotKind pk = cg.sigKindFor(n->as.func_decl.params[p].type_name);
+            if (pk == SLOT_BOXED) native = false;
+            sig.param_kinds.push_back(pk);
+        }
+        if (native) {
+            std::vector<llvm::Type*> rawTys;
+            for (SlotKind pk : sig.param_kinds) rawTys.push_back(cg.slotType(pk));
+            llvm::FunctionType* nft = llvm::FunctionType::get(cg.slotType(sig.ret_kind), rawTys, false);
+            sig.native = llvm::Function::Create(nft, llvm::Function::InternalLinkage,
+                                                std::string("__tn_") + name, cg.mod.get());
+        } else {
+            sig.param_kinds.clear();
+            sig.ret_kind = SLOT_BOXED;
+        }
         cg.funcSigs[name] = sig;
 
         std::vector<llvm::Type*> paramTys(arity, cg.i64Ty);
@@ -519,18 +2295,19 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
     case NODE_NULL_LIT:  return cg.makeNull();
 
     case NODE_STRING_LIT: {
-        std::string s(node->as.string_literal.value, node->as.string_literal.length);
-        llvm::Value* str = cg.makeStringConstant(s);
-        return cg.callRT("rt_string_from_cstr", {str});
+        return cg.makeStaticString(literalText(node));
     }
 
     case NODE_IDENTIFIER: {
         const char* name = node->as.identifier.name;
         llvm::AllocaInst* a = cg.lookupLocal(name);
-        if (a) return cg.B->CreateLoad(cg.i64Ty, a, name);
+        if (a) {
+            SlotKind k = cg.lookupKind(name);
+            return cg.boxSlot(k, cg.loadSlot(cg.slotType(k), a, name));
+        }
         auto git = cg.globals.find(name);
         if (git != cg.globals.end())
-            return cg.B->CreateLoad(cg.i64Ty, git->second, name);
+            return cg.loadSlot(cg.i64Ty, git->second, name);
         return cg.makeNull();
     }
 
@@ -548,8 +2325,7 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
         /* Short-circuit AND */
         if (node->as.binary.op == TOKEN_AND) {
             llvm::Value* lhs = codegenExpr(cg, node->as.binary.left);
-            llvm::Value* cond = cg.B->CreateICmpNE(
-                cg.callRT("rt_is_truthy", {lhs}), cg.i32Val(0));
+            llvm::Value* cond = cg.isTruthy(lhs);
             llvm::Function* F = cg.curFunc;
             llvm::BasicBlock* rhsBB = llvm::BasicBlock::Create(cg.ctx, "and.rhs", F);
             llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(cg.ctx, "and.merge", F);
@@ -568,8 +2344,7 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
         /* Short-circuit OR */
         if (node->as.binary.op == TOKEN_OR) {
             llvm::Value* lhs = codegenExpr(cg, node->as.binary.left);
-            llvm::Value* cond = cg.B->CreateICmpNE(
-                cg.callRT("rt_is_truthy", {lhs}), cg.i32Val(0));
+            llvm::Value* cond = cg.isTruthy(lhs);
             llvm::Function* F = cg.curFunc;
             llvm::BasicBlock* rhsBB = llvm::BasicBlock::Create(cg.ctx, "or.rhs", F);
             llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(cg.ctx, "or.merge", F);
@@ -586,111 +2361,30 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
             return phi;
         }
 
+        if (node->as.binary.op == TOKEN_PLUS) {
+            std::vector<ASTNode*> parts;
+            if (concatChain(cg, node, parts)) return emitConcat(cg, parts);
+        }
+
+        /* Fast path for known types: compute on raw values, box once */
+        SlotKind opKind;
+        if (binaryIsNumeric(cg, node, &opKind)) {
+            if (isComparisonOp(node->as.binary.op))
+                return cg.boxBool(codegenNumericCmp(cg, node, opKind));
+            return cg.boxSlot(opKind, codegenNumeric(cg, node, opKind));
+        }
+
         llvm::Value* lhs = codegenExpr(cg, node->as.binary.left);
         llvm::Value* rhs = codegenExpr(cg, node->as.binary.right);
 
-        /* Fast path for known types */
-        if (cg.mode == MODE_STATIC || cg.mode == MODE_BOTH) {
-            const char* lt = llvm_infer_expr_type(cg, node->as.binary.left);
-            const char* rt = llvm_infer_expr_type(cg, node->as.binary.right);
-
-            if (lt && rt && (strcmp(lt, "int") == 0 || strcmp(lt, "float") == 0) &&
-                            (strcmp(rt, "int") == 0 || strcmp(rt, "float") == 0)) {
-                
-                bool l_is_int = (strcmp(lt, "int") == 0);
-                bool r_is_int = (strcmp(rt, "int") == 0);
-                
-                llvm::Value* l_val = lhs;
-                llvm::Value* r_val = rhs;
-                
-                /* Unbox */
-                if (l_is_int) {
-                    l_val = cg.B->CreateAnd(l_val, 0x0000FFFFFFFFFFFFULL);
-                    l_val = cg.B->CreateShl(l_val, 16);
-                    l_val = cg.B->CreateAShr(l_val, 16);
-                } else {
-                    l_val = cg.B->CreateBitCast(l_val, cg.B->getDoubleTy());
-                }
-                
-                if (r_is_int) {
-                    r_val = cg.B->CreateAnd(r_val, 0x0000FFFFFFFFFFFFULL);
-                    r_val = cg.B->CreateShl(r_val, 16);
-                    r_val = cg.B->CreateAShr(r_val, 16);
-                } else {
-                    r_val = cg.B->CreateBitCast(r_val, cg.B->getDoubleTy());
-                }
-                
-                /* Promote to float if mixed */
-                bool is_float_op = !l_is_int || !r_is_int;
-                if (is_float_op) {
-                    if (l_is_int) l_val = cg.B->CreateSIToFP(l_val, cg.B->getDoubleTy());
-                    if (r_is_int) r_val = cg.B->CreateSIToFP(r_val, cg.B->getDoubleTy());
-                }
-                
-                llvm::Value* res = nullptr;
-                bool is_cmp = false;
-                
-                if (is_float_op) {
-                    switch (node->as.binary.op) {
-                    case TOKEN_PLUS:    res = cg.B->CreateFAdd(l_val, r_val); break;
-                    case TOKEN_MINUS:   res = cg.B->CreateFSub(l_val, r_val); break;
-                    case TOKEN_STAR:    res = cg.B->CreateFMul(l_val, r_val); break;
-                    case TOKEN_SLASH:   res = cg.B->CreateFDiv(l_val, r_val); break;
-                    case TOKEN_EQUAL_EQUAL: res = cg.B->CreateFCmpOEQ(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_BANG_EQUAL:  res = cg.B->CreateFCmpONE(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_LESS:        res = cg.B->CreateFCmpOLT(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_GREATER:     res = cg.B->CreateFCmpOGT(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_LESS_EQUAL:  res = cg.B->CreateFCmpOLE(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_GREATER_EQUAL: res = cg.B->CreateFCmpOGE(l_val, r_val); is_cmp = true; break;
-                    default: /* e.g. TOKEN_PERCENT */ break; // will leave res as nullptr, so it falls back
-                    }
-                } else {
-                    switch (node->as.binary.op) {
-                    case TOKEN_PLUS:    res = cg.B->CreateAdd(l_val, r_val); break;
-                    case TOKEN_MINUS:   res = cg.B->CreateSub(l_val, r_val); break;
-                    case TOKEN_STAR:    res = cg.B->CreateMul(l_val, r_val); break;
-                    case TOKEN_SLASH:   res = cg.B->CreateSDiv(l_val, r_val); break;
-                    case TOKEN_PERCENT: res = cg.B->CreateSRem(l_val, r_val); break;
-                    case TOKEN_EQUAL_EQUAL: res = cg.B->CreateICmpEQ(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_BANG_EQUAL:  res = cg.B->CreateICmpNE(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_LESS:        res = cg.B->CreateICmpSLT(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_GREATER:     res = cg.B->CreateICmpSGT(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_LESS_EQUAL:  res = cg.B->CreateICmpSLE(l_val, r_val); is_cmp = true; break;
-                    case TOKEN_GREATER_EQUAL: res = cg.B->CreateICmpSGE(l_val, r_val); is_cmp = true; break;
-                    default: break;
-                    }
-                }
-                
-                if (res) {
-                    /* Re-box */
-                    if (is_cmp) {
-                        res = cg.B->CreateZExt(res, cg.i64Ty);
-                        return cg.B->CreateOr(res, 0xFFFB000000000000ULL); /* TV_TAG_BOOL */
-                    } else if (is_float_op) {
-                        return cg.B->CreateBitCast(res, cg.i64Ty);
-                    } else {
-                        res = cg.B->CreateAnd(res, 0x0000FFFFFFFFFFFFULL);
-                        return cg.B->CreateOr(res, 0xFFFA000000000000ULL); /* TV_TAG_INT */
-                    }
-                }
-            }
-        }
+        const char* rtName = rtNameForBinary(node->as.binary.op);
+        if (!rtName) return cg.makeNull();
 
-        /* Fallback */
-        switch (node->as.binary.op) {
-        case TOKEN_PLUS:          return cg.callRT("rt_add", {lhs, rhs});
-        case TOKEN_MINUS:         return cg.callRT("rt_sub", {lhs, rhs});
-        case TOKEN_STAR:          return cg.callRT("rt_mul", {lhs, rhs});
-        case TOKEN_SLASH:         return cg.callRT("rt_div", {lhs, rhs});
-        case TOKEN_PERCENT:       return cg.callRT("rt_mod", {lhs, rhs});
-        case TOKEN_EQUAL_EQUAL:   return cg.callRT("rt_eq",  {lhs, rhs});
-        case TOKEN_BANG_EQUAL:    return cg.callRT("rt_neq", {lhs, rhs});
-        case TOKEN_LESS:          return cg.callRT("rt_lt",  {lhs, rhs});
-        case TOKEN_GREATER:       return cg.callRT("rt_gt",  {lhs, rhs});
-        case TOKEN_LESS_EQUAL:    return cg.callRT("rt_lte", {lhs, rhs});
-        case TOKEN_GREATER_EQUAL: return cg.callRT("rt_gte", {lhs, rhs});
-        default: return cg.makeNull();
-        }
+        /* Unknown types: inline INT/FLOAT fast paths, runtime on the cold path */
+        if (!knownNonNumeric(llvm_infer_expr_type(cg, node->as.binary.left)) &&
+            !knownNonNumeric(llvm_infer_expr_type(cg, node->as.binary.right)))
+            return emitTagCheckedBinary(cg, node->as.binary.op, rtName, lhs, rhs);
+        return cg.callRT(rtName, {lhs, rhs});
     }
 
     case NODE_CALL: {
@@ -747,13 +2441,7 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
 
         /* ── Built-in functions ── */
         if (strcmp(name, "print") == 0) {
-            llvm::AllocaInst* arr = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(argc > 0 ? argc : 1), "print_args");
-            for (int i = 0; i < argc; i++) {
-                llvm::Value* v = codegenExpr(cg, node->as.call.args[i]);
-                llvm::Value* ptr = cg.B->CreateGEP(cg.i64Ty, arr, {cg.i32Val(i)});
-                cg.B->CreateStore(v, ptr);
-            }
-            cg.callRT("rt_print", {arr, cg.i32Val(argc)});
+            emitPrint(cg, node);
             return cg.makeNull();
         }
         if (strcmp(name, "input") == 0) {
@@ -761,6 +2449,7 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
             return cg.callRT("rt_input", {prompt});
         }
         if (strcmp(name, "len") == 0) {
+            if (llvm::Value* n = emitArrayLen(cg, node)) return cg.boxInt(n);
             llvm::Value* arg = argc >= 1 ? codegenExpr(cg, node->as.call.args[0]) : cg.makeNull();
             return cg.callRT("rt_len", {arg});
         }
@@ -795,6 +2484,8 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
         if (strcmp(name, "bytesToGB") == 0 && argc>0) return cg.callRT("rt_bytesToGB", {codegenExpr(cg, node->as.call.args[0])});
 
         /* ── User function call ── */
+        if (const FuncSigInfo* sig = nativeSigFor(cg, node))
+            return cg.boxSlot(sig->ret_kind, emitNativeCall(cg, node, *sig));
         auto it = cg.userFuncs.find(name);
         if (it != cg.userFuncs.end()) {
             std::vector<llvm::Value*> args;
@@ -808,53 +2499,99 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
 
     case NODE_LIST_LIT: {
         int count = node->as.list_literal.count;
-        llvm::AllocaInst* arr = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(count > 0 ? count : 1), "list_items");
+        llvm::AllocaInst* arr = cg.scratchArray(count, "list_items");
         for (int i = 0; i < count; i++) {
             llvm::Value* v = codegenExpr(cg, node->as.list_literal.nodes[i]);
-            cg.B->CreateStore(v, cg.B->CreateGEP(cg.i64Ty, arr, {cg.i32Val(i)}));
+            cg.storeSlot(v, cg.B->CreateGEP(cg.i64Ty, arr, {cg.i32Val(i)}));
         }
+        if (node == cg.stackInit) return cg.callRT("rt_list_new_local", {cg.stackMem, arr, cg.i32Val(count)});
         return cg.callRT("rt_list_new", {arr, cg.i32Val(count)});
     }
 
     case NODE_MAP_LIT: {
         int count = node->as.map_literal.count;
-        llvm::AllocaInst* ka = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(count > 0 ? count : 1), "map_keys");
-        llvm::AllocaInst* va = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(count > 0 ? count : 1), "map_vals");
+        llvm::AllocaInst* ka = cg.scratchArray(count, "map_keys");
+        llvm::AllocaInst* va = cg.scratchArray(count, "map_vals");
         for (int i = 0; i < count; i++) {
             llvm::Value* k = codegenExpr(cg, node->as.map_literal.keys[i]);
             llvm::Value* v = codegenExpr(cg, node->as.map_literal.values[i]);
-            cg.B->CreateStore(k, cg.B->CreateGEP(cg.i64Ty, ka, {cg.i32Val(i)}));
-            cg.B->CreateStore(v, cg.B->CreateGEP(cg.i64Ty, va, {cg.i32Val(i)}));
+            cg.storeSlot(k, cg.B->CreateGEP(cg.i64Ty, ka, {cg.i32Val(i)}));
+            cg.storeSlot(v, cg.B->CreateGEP(cg.i64Ty, va, {cg.i32Val(i)}));
+        }
+        /* Distinct literal keys: the map gets a shared shape (dense slots) */
+        bool shaped = count > 0;
+        std::set<std::string> keyTexts;
+        for (int i = 0; i < count && shaped; i++) {
+            ASTNode* k = node->as.map_literal.keys[i];
+            shaped = k->type == NODE_STRING_LIT && keyTexts.insert(literalText(k)).second;
         }
+        llvm::Constant* noSite = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(cg.i8PtrTy));
+        llvm::Value* site = noSite;
+        if (shaped)
+            site = new llvm::GlobalVariable(*cg.mod, cg.i8PtrTy, false, llvm::GlobalValue::PrivateLinkage,
+                                            noSite, ".shape");
+        if (node == cg.stackInit)
+            return cg.callRT("rt_map_new_local", {cg.stackMem, site, ka, va, cg.i32Val(count)});
+        if (shaped) return cg.callRT("rt_map_new_shaped", {site, ka, va, cg.i32Val(count)});
         return cg.callRT("rt_map_new", {ka, va, cg.i32Val(count)});
     }
 
-    case NODE_INDEX:
+    case NODE_INDEX: {
+        const Codegen::CheckedIndex* ci = checkedIndexFor(cg, node->as.index_access.object, node->as.index_access.index);
+        if (SlotKind ek = inlineArrayAccess(cg, node->as.index_access.object, node->as.index_access.index)) {
+            llvm::Value* arr = codegenExpr(cg, node->as.index_access.object);
+            llvm::Value* idx = codegenNumeric(cg, node->as.index_access.index, SLOT_INT);
+            return cg.boxSlot(ek, emitArrayLoad(cg, arr, idx, ek, ci));
+        }
+        if (ci || inlineListAccess(cg, node->as.index_access.object, node->as.index_access.index)) {
+            llvm::Value* list = codegenExpr(cg, node->as.index_access.object);
+            return emitListGet(cg, list, codegenNumeric(cg, node->as.index_access.index, SLOT_INT), ci);
+        }
+        if (node->as.index_access.index->type == NODE_STRING_LIT) {
+            llvm::Value* obj = codegenExpr(cg, node->as.index_access.object);
+            std::string key = literalText(node->as.index_access.index);
+            return cg.callRT("rt_field_get", {obj, cg.staticStringObj(key),
+                                              cg.i32Val((int)hash_string(key.data(), (int)key.size())),
+                                              cg.makeFieldCache()});
+        }
+        if (inlineMapAccess(cg, node->as.index_access.object, node->as.index_access.index)) {
+            llvm::Value* map = codegenExpr(cg, node->as.index_access.object);
+            return emitMapGet(cg, map, codegenExpr(cg, node->as.index_access.index));
+        }
         return cg.callRT("rt_index_get", {
             codegenExpr(cg, node->as.index_access.object),
             codegenExpr(cg, node->as.index_access.index)
         });
+    }
 
     case NODE_ALLOC: {
         llvm::Value* init = codegenExpr(cg, node->as.alloc_expr.init);
+        if (node == cg.stackInit) return cg.callRT("rt_alloc_local", {cg.stackMem, init});
         const char* tn = node->as.alloc_expr.type_name ? node->as.alloc_expr.type_name : "dynamic";
         llvm::Value* typeStr = cg.makeStringConstant(tn);
         return cg.callRT("rt_alloc", {init, typeStr, cg.i32Val(node->line)});
     }
 
     case NODE_ASSIGN: {
-        llvm::Value* val = codegenExpr(cg, node->as.assign.value);
         const char* name = node->as.assign.name;
         llvm::AllocaInst* a = cg.lookupLocal(name);
-        if (a) { cg.B->CreateStore(val, a); return val; }
+        SlotKind k = a ? cg.lookupKind(name) : SLOT_BOXED;
+        if (k != SLOT_BOXED) {
+            llvm::Value* raw = codegenNumeric(cg, node->as.assign.value, k);
+            cg.storeSlot(raw, a);
+            return cg.boxSlot(k, raw);
+        }
+        llvm::Value* val = codegenExpr(cg, node->as.assign.value);
+        if (SlotKind ek = arrayElemKind(cg.declaredType(name))) val = cg.convertToArray(ek, val);
+        if (a) { cg.storeSlot(val, a); return val; }
         auto git = cg.globals.find(name);
-        if (git != cg.globals.end()) { cg.B->CreateStore(val, git->second); return val; }
+        if (git != cg.globals.end()) { cg.storeSlot(val, git->second); return val; }
         /* Implicit global */
         auto* gv = new llvm::GlobalVariable(*cg.mod, cg.i64Ty, false,
                                             llvm::GlobalValue::InternalLinkage,
                                             llvm::ConstantInt::get(cg.i64Ty, TV_NULL), name);
         cg.globals[name] = gv;
-        cg.B->CreateStore(val, gv);
+        cg.storeSlot(val, gv);
         return val;
     }
 
@@ -866,9 +2603,41 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
             return val;
         }
         llvm::Value* obj = codegenExpr(cg, node->as.index_assign.object);
+        const Codegen::CheckedIndex* ci = checkedIndexFor(cg, node->as.index_assign.object, node->as.index_assign.index);
+        if (SlotKind ek = inlineArrayAccess(cg, node->as.index_assign.object, node->as.index_assign.index)) {
+            llvm::Value* idx = codegenNumeric(cg, node->as.index_assign.index, SLOT_INT);
+            llvm::Value* raw = codegenNumeric(cg, node->as.index_assign.value, ek);
+            emitArrayStore(cg, obj, idx, ek, raw, ci);
+            return cg.boxSlot(ek, raw);
+        }
+        if (ci || inlineListAccess(cg, node->as.index_assign.object, node->as.index_assign.index)) {
+            llvm::Value* idx = codegenNumeric(cg, node->as.index_assign.index, SLOT_INT);
+            SlotKind vk = numericKind(llvm_infer_expr_type(cg, node->as.index_assign.value));
+            llvm::Value* raw = nullptr;
+            llvm::Value* val;
+            if (vk != SLOT_BOXED) {
+                raw = codegenNumeric(cg, node->as.index_assign.value, vk);
+                val = cg.boxSlot(vk, raw);
+            } else {
+                val = codegenExpr(cg, node->as.index_assign.value);
+            }
+            emitListSet(cg, obj, idx, val, vk, raw, ci);
+            return val;
+        }
+        if (node->as.index_assign.index->type == NODE_STRING_LIT) {
+            std::string key = literalText(node->as.index_assign.index);
+            llvm::Value* val = codegenExpr(cg, node->as.index_assign.value);
+            cg.callRT("rt_field_set", {obj, cg.staticStringObj(key),
+                                       cg.i32Val((int)hash_string(key.data(), (int)key.size())),
+                                       cg.makeFieldCache(), val});
+            return val;
+        }
         llvm::Value* idx = codegenExpr(cg, node->as.index_assign.index);
         llvm::Value* val = codegenExpr(cg, node->as.index_assign.value);
-        cg.callRT("rt_index_set", {obj, idx, val});
+        if (inlineMapAccess(cg, node->as.index_assign.object, node->as.index_assign.index))
+            emitMapSet(cg, obj, idx, val);
+        else
+            cg.callRT("rt_index_set", {obj, idx, val});
         return val;
     }
 
@@ -881,10 +2650,29 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
         if (!a) { auto git = cg.globals.find(name); if (git != cg.globals.end()) gv = git->second; }
         llvm::Value* ptr = a ? (llvm::Value*)a : (llvm::Value*)gv;
         if (!ptr) return cg.makeNull();
-        llvm::Value* old = cg.B->CreateLoad(cg.i64Ty, ptr, "old");
-        llvm::Value* one = cg.makeInt(1);
-        llvm::Value* nv = is_inc ? cg.callRT("rt_add", {old, one}) : cg.callRT("rt_sub", {old, one});
-        cg.B->CreateStore(nv, ptr);
+        SlotKind k = a ? cg.lookupKind(name) : SLOT_BOXED;
+        auto step = [&](SlotKind sk, llvm::Value* raw) -> llvm::Value* {
+            if (sk == SLOT_INT) return is_inc ? cg.B->CreateAdd(raw, cg.i64Val(1)) : cg.B->CreateSub(raw, cg.i64Val(1));
+            llvm::Value* one = llvm::ConstantFP::get(cg.f64Ty, 1.0);
+            return is_inc ? cg.B->CreateFAdd(raw, one) : cg.B->CreateFSub(raw, one);
+        };
+        if (k != SLOT_BOXED) {
+            llvm::Value* raw = cg.loadSlot(cg.slotType(k), a, "old");
+            cg.storeSlot(step(k, raw), a);
+            return cg.boxSlot(k, raw);
+        }
+        llvm::Value* old = cg.loadSlot(cg.i64Ty, ptr, "old");
+        /* Boxed, but statically numeric: step the unboxed value */
+        SlotKind vk = (cg.mode == MODE_DYNAMIC) ? SLOT_BOXED
+                                                : numericKind(llvm_infer_expr_type(cg, node->as.postfix.operand));
+        llvm::Value* nv;
+        if (vk == SLOT_INT)        nv = cg.boxInt(step(vk, cg.unboxInt(old)));
+        else if (vk == SLOT_FLOAT) nv = cg.boxFloat(step(vk, cg.unboxFloat(old)));
+        else {
+            llvm::Value* one = cg.makeInt(1);
+            nv = is_inc ? cg.callRT("rt_add", {old, one}) : cg.callRT("rt_sub", {old, one});
+        }
+        cg.storeSlot(nv, ptr);
         return old;
     }
 
@@ -897,6 +2685,204 @@ static llvm::Value* codegenExpr(Codegen& cg, ASTNode* node) {
  *  Statement codegen
  * ══════════════════════════════════════════════════════════════════ */
 
+/* ══════════════════════════════════════════════════════════════════
+ *  Counted range loops
+ *  `for x in range(...)` becomes a plain induction-variable loop with no
+ *  ObjRange.  Mirrors rt_range: non-int bounds or a zero step give an
+ *  empty loop, and x is reassigned from a hidden counter every iteration.
+ * ══════════════════════════════════════════════════════════════════ */
+
+/* Whether `node` could change the length of a list or array it never
+ * names: append, free, or a call that might reach one */
+static bool llvm_may_resize(Codegen& cg, ASTNode* node) {
+    if (node->type == NODE_FREE) return true;
+    if (node->type == NODE_CALL) {
+        ASTNode* callee = node->as.call.callee;
+        if (callee->type != NODE_IDENTIFIER) return true;
+        const char* name = callee->as.identifier.name;
+        if (strcmp(name, "append") == 0 || cg.userFuncs.count(name)) return true;
+    }
+    bool resizes = false;
+    forEachChild(node, [&](ASTNode* c) { resizes = resizes || llvm_may_resize(cg, c); });
+    return resizes;
+}
+
+/* For `for i in range(len(xs))`, the xs identifier if every xs[i] in the
+ * body stays in bounds: xs is a list or typed array, and the body neither
+ * rebinds xs or i nor resizes anything.  len(xs) is read once before the
+ * first iteration, so the loop bound is the bounds check. */
+static ASTNode* rangeOverLen(Codegen& cg, ASTNode* node) {
+    ASTNode* call = node->as.for_in.iterable;
+    if (cg.mode == MODE_DYNAMIC || call->as.call.arg_count != 1) return nullptr;
+    ASTNode* len = call->as.call.args[0];
+    if (len->type != NODE_CALL || len->as.call.arg_count != 1 ||
+        len->as.call.callee->type != NODE_IDENTIFIER ||
+        strcmp(len->as.call.callee->as.identifier.name, "len") != 0 || cg.funcSigs.count("len"))
+        return nullptr;
+    ASTNode* xs = len->as.call.args[0];
+    if (xs->type != NODE_IDENTIFIER) return nullptr;
+    const char* type = llvm_infer_expr_type(cg, xs);
+    if (!type || (strcmp(type, "list") != 0 && arrayElemKind(type) == SLOT_BOXED)) return nullptr;
+    ASTNode* body = node->as.for_in.body;
+    if (!body) return xs;
+    FlowFuncInfo info;
+    flowCollect(body, info);
+    for (const char* name : {xs->as.identifier.name, node->as.for_in.var_name})
+        if (info.writes.count(name) || info.scoped.count(name)) return nullptr;
+    return llvm_may_resize(cg, body) ? nullptr : xs;
+}
+
+static void codegenRangeLoop(Codegen& cg, ASTNode* node) {
+    llvm::Function* F = cg.curFunc;
+    ASTNode* call = node->as.for_in.iterable;
+    int argc = call->as.call.arg_count < 3 ? call->as.call.arg_count : 3;
+    const char* var = node->as.for_in.var_name;
+    cg.pushScope();
+    cg.callRT("rt_enter_scope", {});
+
+    llvm::Value* valid = llvm::ConstantInt::getTrue(cg.ctx);
+    llvm::Value* bounds[3];
+    for (int i = 0; i < argc; i++) {
+        ASTNode* a = call->as.call.args[i];
+        if (a->type == NODE_INT_LIT ||
+            (cg.mode != MODE_DYNAMIC && numericKind(llvm_infer_expr_type(cg, a)) == SLOT_INT)) {
+            bounds[i] = codegenNumeric(cg, a, SLOT_INT);
+        } else {
+            llvm::Value* v = codegenExpr(cg, a);
+            valid = cg.B->CreateAnd(valid, cg.B->CreateICmpEQ(cg.B->CreateLShr(v, 48), cg.i64Val(0xFFFA)));
+            bounds[i] = cg.unboxInt(v);
+        }
+    }
+    llvm::Value* start = cg.i64Val(0);
+    llvm::Value* end   = cg.i64Val(0);
+    llvm::Value* step  = cg.i64Val(1);
+    if (argc == 0) valid = llvm::ConstantInt::getFalse(cg.ctx);
+    else if (argc == 1) end = bounds[0];
+    else { start = bounds[0]; end = bounds[1]; }
+    if (argc == 3) {
+        step = bounds[2];
+        valid = cg.B->CreateAnd(valid, cg.B->CreateICmpNE(step, cg.i64Val(0)));
+    }
+    llvm::Value* stepPos = cg.B->CreateICmpSGT(step, cg.i64Val(0));
+    ASTNode* indexed = rangeOverLen(cg, node);
+
+    llvm::AllocaInst* ctrA = cg.createEntryAlloca(F, "$range.i");
+    cg.storeSlot(start, ctrA);
+    /* The variable stays a raw int unless the body assigns to it */
+    SlotKind vk = llvm_assigns_name(node->as.for_in.body, var) ? SLOT_BOXED : SLOT_INT;
+    llvm::AllocaInst* varA = cg.createEntryAlloca(F, var, cg.slotType(vk));
+    cg.setLocal(var, varA, vk == SLOT_INT ? "int" : nullptr, vk);
+    size_t checkedMark = cg.checkedIndices.size();
+    if (indexed && vk == SLOT_INT) {
+        /* Nothing in the body can reallocate an array's data, and a
+         * `list` variable may still hold a non-list at runtime: both are
+         * settled once here rather than on every access */
+        llvm::Value* data = nullptr;
+        llvm::Value* isList = nullptr;
+        if (arrayElemKind(llvm_infer_expr_type(cg, indexed)) != SLOT_BOXED)
+            data = cg.arrayData(codegenExpr(cg, indexed));
+        else
+            isList = cg.B->CreateICmpEQ(cg.callRT("rt_for_in_kind", {codegenExpr(cg, indexed)}),
+                                        cg.i32Val(RT_FOR_IN_LIST));
+        cg.checkedIndices.push_back({indexed->as.identifier.name, var, data, isList});
+    }
+
+    llvm::BasicBlock* condBB = llvm::BasicBlock::Create(cg.ctx, "range.cond", F);
+    llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(cg.ctx, "range.body", F);
+    llvm::BasicBlock* incrBB = llvm::BasicBlock::Create(cg.ctx, "range.incr", F);
+    llvm::BasicBlock* exitBB = llvm::BasicBlock::Create(cg.ctx, "range.exit", F);
+    cg.condBrLikely(valid, condBB, exitBB);
+
+    cg.B->SetInsertPoint(condBB);
+    llvm::Value* i = cg.loadSlot(cg.i64Ty, ctrA);
+    llvm::Value* more = cg.B->CreateSelect(stepPos, cg.B->CreateICmpSLT(i, end), cg.B->CreateICmpSGT(i, end));
+    cg.B->CreateCondBr(more, bodyBB, exitBB);
+
+    cg.B->SetInsertPoint(bodyBB);
+    cg.storeSlot(vk == SLOT_INT ? i : cg.boxInt(i), varA);
+    cg.loopStack.push_back({condBB, exitBB, incrBB});
+    codegenStmt(cg, node->as.for_in.body);
+    cg.checkedIndices.resize(checkedMark);
+    if (!cg.B->GetInsertBlock()->getTerminator()) cg.B->CreateBr(incrBB);
+    cg.loopStack.pop_back();
+
+    cg.B->SetInsertPoint(incrBB);
+    cg.storeSlot(cg.B->CreateAdd(cg.loadSlot(cg.i64Ty, ctrA), step), ctrA);
+    cg.B->CreateBr(condBB);
+
+    cg.B->SetInsertPoint(exitBB);
+    cg.callRT("rt_exit_scope", {});
+    cg.popScope();
+}
+
+/* ══════════════════════════════════════════════════════════════════
+ *  Tail calls
+ *  `return f(...)` to a user function becomes a musttail call: the
+ *  arguments are evaluated, the cleanup a plain return would run after
+ *  the call is hoisted in front of it, and the frame is reused.
+ * ══════════════════════════════════════════════════════════════════ */
+
+static bool llvm_contains_alloc(ASTNode* node) {
+    if (!node) return false;
+    if (node->type == NODE_ALLOC) return true;
+    bool found = false;
+    forEachChild(node, [&](ASTNode* c) { found = found || llvm_contains_alloc(c); });
+    return found;
+}
+
+/* Emit `return call` as a musttail call.  Returns false, having emitted
+ * nothing, when it can't be guaranteed; the reason goes to the report. */
+static bool emitTailCall(Codegen& cg, ASTNode* call) {
+    if (!call || call->type != NODE_CALL || call->as.call.callee->type != NODE_IDENTIFIER) return false;
+    const char* name = call->as.call.callee->as.identifier.name;
+    auto uf = cg.userFuncs.find(name);
+    if (uf == cg.userFuncs.end()) return false;
+    cg.tailCallSites++;
+
+    const FuncSigInfo& sig = cg.funcSigs[name];
+    SlotKind rk = cg.curRetKind;
+    int argc = call->as.call.arg_count;
+    llvm::Function* target = nullptr;
+    const char* why = nullptr;
+    if (cg.tryNesting > 0)
+        why = "inside a try block (its handler must stay live)";
+    else if (argc != sig.param_count)
+        why = "argument count differs from the callee's";
+    else if (arrayElemKind(cg.curRetType))
+        why = "result is converted to a typed array";
+    else if (cg.autofree_enabled && cg.curFuncAllocs)
+        why = "pointers allocated here are auto-freed after the call";
+    else {
+        /* Boxed callers go through the callee's boxed entry point; native
+         * bodies only tail-call a native body with the same raw signature */
+        target = (rk == SLOT_BOXED) ? uf->second : (sig.native && sig.ret_kind == rk ? sig.native : nullptr);
+        if (!target || target->getFunctionType() != cg.curFunc->getFunctionType())
+            why = "callee's signature differs from the caller's";
+    }
+    if (why) {
+        char buf[512];
+        snprintf(buf, sizeof(buf), "%s:%d: %s() -> %s(): %s",
+                 cg.sourcePath ? cg.sourcePath : "<input>", call->line,
+                 cg.curFuncName ? cg.curFuncName : "?", name, why);
+        cg.tailCallMisses.push_back(buf);
+        return false;
+    }
+
+    std::vector<llvm::Value*> args;
+    for (int i = 0; i < argc; i++)
+        args.push_back(rk == SLOT_BOXED ? codegenExpr(cg, call->as.call.args[i])
+                                        : codegenRaw(cg, call->as.call.args[i], sig.param_kinds[i]));
+    for (int si = (int)cg.localInfoScopes.size() - 1; si >= 0; si--) {
+        emitScopeCleanup(cg, cg.localInfoScopes[si]);
+        cg.callRT("rt_exit_scope", {});
+    }
+    llvm::CallInst* ci = cg.B->CreateCall(target, args);
+    ci->setCallingConv(target->getCallingConv());
+    ci->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    cg.B->CreateRet(ci);
+    return true;
+}
+
 static void codegenStmt(Codegen& cg, ASTNode* node) {
     if (!node) return;
 
@@ -908,43 +2894,74 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
     case NODE_VAR_DECL: {
         const char* name = node->as.var_decl.name;
         llvm::Value* init;
-        if (node->as.var_decl.init) {
+        /* Typed int/float locals live unboxed in their alloca */
+        SlotKind slotKind = (cg.scopes.size() > 1) ? cg.slotKindFor(node->as.var_decl.type_name) : SLOT_BOXED;
+        /* Non-escaping pointer/collection: the object lives in the frame */
+        llvm::Value* stackMem = nullptr;
+        if (cg.pendingStorage && cg.scopes.size() > 1 && slotKind == SLOT_BOXED) {
+            llvm::AllocaInst* mem = cg.createEntryAlloca(cg.curFunc, std::string(name) + ".obj",
+                llvm::ArrayType::get(llvm::Type::getInt8Ty(cg.ctx), cg.pendingStorage));
+            mem->setAlignment(llvm::Align(16));
+            stackMem = mem;
+        }
+        cg.pendingStorage = 0;
+        if (slotKind != SLOT_BOXED) {
+            if (node->as.var_decl.init)
+                init = codegenNumeric(cg, node->as.var_decl.init, slotKind);
+            else if (slotKind == SLOT_INT)
+                init = cg.i64Val(0);
+            else
+                init = llvm::ConstantFP::get(cg.f64Ty, 0.0);
+        } else if (node->as.var_decl.init) {
+            ASTNode* savedInit = cg.stackInit;
+            llvm::Value* savedMem = cg.stackMem;
+            if (stackMem) { cg.stackInit = node->as.var_decl.init; cg.stackMem = stackMem; }
             init = codegenExpr(cg, node->as.var_decl.init);
+            cg.stackInit = savedInit;
+            cg.stackMem = savedMem;
         } else {
             if (node->as.var_decl.type_name) {
                 if (strcmp(node->as.var_decl.type_name, "int") == 0)        init = cg.makeInt(0);
                 else if (strcmp(node->as.var_decl.type_name, "float") == 0) init = cg.makeFloat(0.0);
                 else if (strcmp(node->as.var_decl.type_name, "bool") == 0)  init = cg.makeBool(false);
                 else if (strcmp(node->as.var_decl.type_name, "string") == 0)
-                    init = cg.callRT("rt_string_from_cstr", {(llvm::Value*)cg.makeStringConstant("")});
+                    init = cg.makeStaticString("");
+                else if (SlotKind ek = arrayElemKind(node->as.var_decl.type_name))
+                    init = cg.convertToArray(ek, cg.makeNull());
                 else if (strcmp(node->as.var_decl.type_name, "list") == 0) {
-                    llvm::AllocaInst* ea = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(1));
-                    init = cg.callRT("rt_list_new", {ea, cg.i32Val(0)});
+                    llvm::AllocaInst* ea = cg.scratchArray(0, "list_items");
+                    init = stackMem ? cg.callRT("rt_list_new_local", {stackMem, ea, cg.i32Val(0)})
+                                    : cg.callRT("rt_list_new", {ea, cg.i32Val(0)});
                 }
                 else if (strcmp(node->as.var_decl.type_name, "map") == 0) {
-                    llvm::AllocaInst* ek = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(1));
-                    llvm::AllocaInst* ev = cg.B->CreateAlloca(cg.i64Ty, cg.i32Val(1));
-                    init = cg.callRT("rt_map_new", {ek, ev, cg.i32Val(0)});
+                    llvm::AllocaInst* ek = cg.scratchArray(0, "map_keys");
+                    llvm::AllocaInst* ev = cg.scratchArray(0, "map_vals");
+                    init = stackMem ? cg.callRT("rt_map_new_local", {stackMem,
+                                          llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(cg.i8PtrTy)),
+                                          ek, ev, cg.i32Val(0)})
+                                    : cg.callRT("rt_map_new", {ek, ev, cg.i32Val(0)});
                 }
                 else init = cg.makeNull();
             } else init = cg.makeNull();
         }
         /* Auto-cast */
-        if (node->as.var_decl.type_name && node->as.var_decl.init &&
+        if (slotKind == SLOT_BOXED && node->as.var_decl.type_name && node->as.var_decl.init &&
             node->as.var_decl.init->type != NODE_ALLOC) {
             int cast_tag = -1;
             if (strcmp(node->as.var_decl.type_name, "int") == 0)    cast_tag = 0;
             if (strcmp(node->as.var_decl.type_name, "float") == 0)  cast_tag = 1;
             if (strcmp(node->as.var_decl.type_name, "string") == 0) cast_tag = 2;
             if (strcmp(node->as.var_decl.type_name, "bool") == 0)   cast_tag = 3;
+            if (strcmp(node->as.var_decl.type_name, "int[]") == 0)  cast_tag = 4;
+            if (strcmp(node->as.var_decl.type_name, "float[]") == 0) cast_tag = 5;
             if (cast_tag >= 0)
                 init = cg.callRT("rt_cast", {init, cg.i32Val(cast_tag)});
         }
 
         if (cg.scopes.size() > 1) {
-            llvm::AllocaInst* a = cg.createEntryAlloca(cg.curFunc, name);
-            cg.B->CreateStore(init, a);
-            cg.setLocal(name, a, node->as.var_decl.type_name);
+            llvm::AllocaInst* a = cg.createEntryAlloca(cg.curFunc, name, cg.slotType(slotKind));
+            cg.storeSlot(init, a);
+            cg.setLocal(name, a, node->as.var_decl.type_name, slotKind);
 
             /* Track LocalInfo for memory safety */
             if (!cg.localInfoScopes.empty()) {
@@ -955,6 +2972,9 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
                 li.holds_alloc = false;
                 li.auto_free = false;
                 li.auto_free_collection = false;
+                li.stack_obj = stackMem;
+                li.stack_collection = stackMem && (!node->as.var_decl.init ||
+                                                   node->as.var_decl.init->type != NODE_ALLOC);
 
                 if (node->as.var_decl.init && node->as.var_decl.init->type == NODE_ALLOC) {
                     li.holds_alloc = true;
@@ -976,7 +2996,7 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
                                                 llvm::ConstantInt::get(cg.i64Ty, TV_NULL), name);
             cg.globals[name] = gv;
             if (node->as.var_decl.type_name) cg.globalTypes[name] = node->as.var_decl.type_name;
-            cg.B->CreateStore(init, gv);
+            cg.storeSlot(init, gv);
         }
         break;
     }
@@ -987,6 +3007,7 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         cg.callRT("rt_enter_scope", {});
         cg.scopeDepth++;
         for (int i = 0; i < node->as.block.count; i++) {
+            cg.pendingStorage = llvm_local_storage_size(cg, node, i);
             codegenStmt(cg, node->as.block.nodes[i]);
             if (cg.B->GetInsertBlock()->getTerminator()) break;
 
@@ -1054,8 +3075,7 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         break;
 
     case NODE_IF: {
-        llvm::Value* cv = codegenExpr(cg, node->as.if_stmt.cond);
-        llvm::Value* cond = cg.B->CreateICmpNE(cg.callRT("rt_is_truthy", {cv}), cg.i32Val(0), "ifcond");
+        llvm::Value* cond = codegenCond(cg, node->as.if_stmt.cond);
         llvm::Function* F = cg.curFunc;
         llvm::BasicBlock* thenBB = llvm::BasicBlock::Create(cg.ctx, "then", F);
         llvm::BasicBlock* elseBB = llvm::BasicBlock::Create(cg.ctx, "else", F);
@@ -1078,8 +3098,7 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         llvm::BasicBlock* exitBB = llvm::BasicBlock::Create(cg.ctx, "while.exit", F);
         cg.B->CreateBr(condBB);
         cg.B->SetInsertPoint(condBB);
-        llvm::Value* cv = codegenExpr(cg, node->as.while_stmt.cond);
-        cg.B->CreateCondBr(cg.B->CreateICmpNE(cg.callRT("rt_is_truthy", {cv}), cg.i32Val(0)), bodyBB, exitBB);
+        cg.B->CreateCondBr(codegenCond(cg, node->as.while_stmt.cond), bodyBB, exitBB);
         cg.loopStack.push_back({condBB, exitBB, condBB});
         cg.B->SetInsertPoint(bodyBB);
         codegenStmt(cg, node->as.while_stmt.body);
@@ -1091,38 +3110,93 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
 
     case NODE_FOR_IN: {
         llvm::Function* F = cg.curFunc;
+        ASTNode* iterNode = node->as.for_in.iterable;
+        if (iterNode->type == NODE_CALL && iterNode->as.call.callee->type == NODE_IDENTIFIER &&
+            strcmp(iterNode->as.call.callee->as.identifier.name, "range") == 0) {
+            codegenRangeLoop(cg, node);
+            break;
+        }
         cg.pushScope();
         cg.callRT("rt_enter_scope", {});
         llvm::Value* iterable = codegenExpr(cg, node->as.for_in.iterable);
         llvm::AllocaInst* iterA = cg.createEntryAlloca(F, "$iter");
-        cg.B->CreateStore(iterable, iterA);
+        cg.storeSlot(iterable, iterA);
         llvm::AllocaInst* counterA = cg.createEntryAlloca(F, "$idx");
-        cg.B->CreateStore(llvm::ConstantInt::get(cg.i64Ty, 0), counterA);
+        cg.storeSlot(llvm::ConstantInt::get(cg.i64Ty, 0), counterA);
         llvm::AllocaInst* varA = cg.createEntryAlloca(F, node->as.for_in.var_name);
-        cg.B->CreateStore(cg.makeNull(), varA);
+        cg.storeSlot(cg.makeNull(), varA);
         cg.setLocal(node->as.for_in.var_name, varA);
+        /* Decide the iterable kind once; each iteration then only takes a
+         * loop-invariant switch into the list/string/generic element read.
+         * A kind proven by the flow pass folds the switch away entirely. */
+        const char* flowType = nullptr;
+        if (iterNode->type == NODE_LIST_LIT)        flowType = "list";
+        else if (iterNode->type == NODE_STRING_LIT) flowType = "string";
+        else {
+            auto ft = cg.flowTypes.find(iterNode);
+            if (ft != cg.flowTypes.end()) flowType = ft->second;
+        }
+        llvm::Value* kind;
+        if (flowType && strcmp(flowType, "list") == 0)        kind = cg.i32Val(RT_FOR_IN_LIST);
+        else if (flowType && strcmp(flowType, "string") == 0) kind = cg.i32Val(RT_FOR_IN_STRING);
+        else kind = cg.callRT("rt_for_in_kind", {iterable});
 
         llvm::BasicBlock* condBB = llvm::BasicBlock::Create(cg.ctx, "for.cond", F);
+        llvm::BasicBlock* listBB = llvm::BasicBlock::Create(cg.ctx, "for.list", F);
+        llvm::BasicBlock* strBB  = llvm::BasicBlock::Create(cg.ctx, "for.str", F);
+        llvm::BasicBlock* genBB  = llvm::BasicBlock::Create(cg.ctx, "for.generic", F);
         llvm::BasicBlock* bodyBB = llvm::BasicBlock::Create(cg.ctx, "for.body", F);
         llvm::BasicBlock* incrBB = llvm::BasicBlock::Create(cg.ctx, "for.incr", F);
         llvm::BasicBlock* exitBB = llvm::BasicBlock::Create(cg.ctx, "for.exit", F);
         cg.B->CreateBr(condBB);
 
         cg.B->SetInsertPoint(condBB);
-        llvm::Value* iter = cg.B->CreateLoad(cg.i64Ty, iterA);
-        llvm::Value* idx = cg.B->CreateLoad(cg.i64Ty, counterA);
+        llvm::Value* iter = cg.loadSlot(cg.i64Ty, iterA);
+        llvm::Value* idx = cg.loadSlot(cg.i64Ty, counterA);
+        llvm::SwitchInst* sw = cg.B->CreateSwitch(kind, genBB, 2);
+        sw->addCase(cg.i32Val(RT_FOR_IN_LIST), listBB);
+        sw->addCase(cg.i32Val(RT_FOR_IN_STRING), strBB);
+
+        /* Lists: count is reloaded every iteration so appends are seen */
+        cg.B->SetInsertPoint(listBB);
+        llvm::BasicBlock* listElemBB = llvm::BasicBlock::Create(cg.ctx, "for.list.elem", F);
+        cg.B->CreateCondBr(cg.B->CreateICmpSLT(idx, cg.callRT("rt_list_count", {iter})), listElemBB, exitBB);
+        cg.B->SetInsertPoint(listElemBB);
+        llvm::Value* listElem = cg.callRT("rt_list_item", {iter, idx});
+        cg.B->CreateBr(bodyBB);
+
+        /* Strings: one-byte strings by byte offset */
+        cg.B->SetInsertPoint(strBB);
+        llvm::BasicBlock* strElemBB = llvm::BasicBlock::Create(cg.ctx, "for.str.elem", F);
+        cg.B->CreateCondBr(cg.B->CreateICmpSLT(idx, cg.callRT("rt_string_length", {iter})), strElemBB, exitBB);
+        cg.B->SetInsertPoint(strElemBB);
+        llvm::Value* strElem = cg.callRT("rt_string_char", {iter, idx});
+        cg.B->CreateBr(bodyBB);
+
+        /* Ranges, maps, anything else: generic runtime stepping */
+        cg.B->SetInsertPoint(genBB);
+        llvm::BasicBlock* genElemBB = llvm::BasicBlock::Create(cg.ctx, "for.generic.elem", F);
         llvm::Value* hasNext = cg.callRT("rt_for_in_has_next", {iter, idx});
-        cg.B->CreateCondBr(cg.B->CreateICmpNE(hasNext, cg.i32Val(0)), bodyBB, exitBB);
+        cg.B->CreateCondBr(cg.B->CreateICmpNE(hasNext, cg.i32Val(0)), genElemBB, exitBB);
+        cg.B->SetInsertPoint(genElemBB);
+        llvm::AllocaInst* stepCtrA = cg.createEntryAlloca(F, "$step.idx");
+        cg.storeSlot(idx, stepCtrA);    /* rt_for_in_step bumps its own copy */
+        llvm::Value* genElem = cg.callRT("rt_for_in_step", {iter, stepCtrA});
+        cg.B->CreateBr(bodyBB);
 
         cg.B->SetInsertPoint(bodyBB);
-        llvm::Value* step = cg.callRT("rt_for_in_step", {iter, counterA});
-        cg.B->CreateStore(step, varA);
+        llvm::PHINode* elem = cg.B->CreatePHI(cg.i64Ty, 3, "for.elem");
+        elem->addIncoming(listElem, listElemBB);
+        elem->addIncoming(strElem, strElemBB);
+        elem->addIncoming(genElem, genElemBB);
+        cg.storeSlot(elem, varA);
         cg.loopStack.push_back({condBB, exitBB, incrBB});
         codegenStmt(cg, node->as.for_in.body);
         if (!cg.B->GetInsertBlock()->getTerminator()) cg.B->CreateBr(incrBB);
         cg.loopStack.pop_back();
 
         cg.B->SetInsertPoint(incrBB);
+        cg.storeSlot(cg.B->CreateAdd(cg.loadSlot(cg.i64Ty, counterA), cg.i64Val(1)), counterA);
         cg.B->CreateBr(condBB);
 
         cg.B->SetInsertPoint(exitBB);
@@ -1136,12 +3210,34 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         auto it = cg.userFuncs.find(fname);
         if (it == cg.userFuncs.end()) break;
         llvm::Function* fn = it->second;
+        const FuncSigInfo& sig = cg.funcSigs[fname];
         llvm::Function* savedFunc = cg.curFunc;
+        SlotKind savedRetKind = cg.curRetKind;
+        const char* savedRetType = cg.curRetType;
+        const char* savedFuncName = cg.curFuncName;
+        bool savedFuncAllocs = cg.curFuncAllocs;
         int savedScopeDepth = cg.scopeDepth;
         auto savedLocalInfoScopes = std::move(cg.localInfoScopes);
         cg.scopeDepth = 0;
         cg.localInfoScopes.clear();
+
+        /* Boxed entry point for dynamic callers: unbox, call native, rebox */
+        if (sig.native) {
+            cg.curFunc = fn;
+            cg.B->SetInsertPoint(llvm::BasicBlock::Create(cg.ctx, "entry", fn));
+            std::vector<llvm::Value*> rawArgs;
+            int ai = 0;
+            for (auto& arg : fn->args())
+                rawArgs.push_back(cg.coerceToSlot(sig.param_kinds[ai++], &arg));
+            cg.B->CreateRet(cg.boxSlot(sig.ret_kind, cg.B->CreateCall(sig.native, rawArgs)));
+            fn = sig.native;
+        }
+
         cg.curFunc = fn;
+        cg.curRetKind = sig.ret_kind;
+        cg.curRetType = node->as.func_decl.ret_type;
+        cg.curFuncName = fname;
+        cg.curFuncAllocs = llvm_contains_alloc(node->as.func_decl.body);
         llvm::BasicBlock* entry = llvm::BasicBlock::Create(cg.ctx, "entry", fn);
         cg.B->SetInsertPoint(entry);
         cg.pushScope();
@@ -1149,34 +3245,52 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         int pi = 0;
         for (auto& arg : fn->args()) {
             std::string pname = node->as.func_decl.params[pi].name;
-            llvm::AllocaInst* a = cg.createEntryAlloca(fn, pname);
-            cg.B->CreateStore(&arg, a);
-            cg.setLocal(pname, a, node->as.func_decl.params[pi].type_name);
+            const char* ptype = node->as.func_decl.params[pi].type_name;
+            SlotKind pk = cg.slotKindFor(ptype);
+            llvm::AllocaInst* a = cg.createEntryAlloca(fn, pname, cg.slotType(pk));
+            llvm::Value* pv;
+            if (!sig.native)                         pv = cg.coerceToSlot(pk, &arg);
+            else if (sig.param_kinds[pi] == SLOT_BOOL) pv = cg.boxBool(&arg);
+            else                                     pv = &arg;
+            if (SlotKind ek = arrayElemKind(ptype))  pv = cg.convertToArray(ek, pv);
+            cg.storeSlot(pv, a);
+            cg.setLocal(pname, a, ptype, pk);
             pi++;
         }
         ASTNode* body = node->as.func_decl.body;
         codegenStmt(cg, body);
         if (!cg.B->GetInsertBlock()->getTerminator())
-            cg.B->CreateRet(cg.makeNull());
+            cg.B->CreateRet(sig.native ? cg.zeroSlot(sig.ret_kind) : cg.makeNull());
         if (!cg.localInfoScopes.empty()) cg.localInfoScopes.pop_back();
         cg.popScope();
         cg.curFunc = savedFunc;
+        cg.curRetKind = savedRetKind;
+        cg.curRetType = savedRetType;
+        cg.curFuncName = savedFuncName;
+        cg.curFuncAllocs = savedFuncAllocs;
         cg.scopeDepth = savedScopeDepth;
         cg.localInfoScopes = std::move(savedLocalInfoScopes);
         break;
     }
 
     case NODE_RETURN: {
-        llvm::Value* retVal = node->as.child ? codegenExpr(cg, node->as.child) : cg.makeNull();
+        if (emitTailCall(cg, node->as.child)) break;
+        SlotKind rk = cg.curRetKind;
+        llvm::Value* retVal;
+        if (rk != SLOT_BOXED)
+            retVal = node->as.child ? codegenRaw(cg, node->as.child, rk) : cg.zeroSlot(rk);
+        else
+            retVal = node->as.child ? codegenExpr(cg, node->as.child) : cg.makeNull();
+        if (SlotKind ek = arrayElemKind(cg.curRetType)) retVal = cg.convertToArray(ek, retVal);
         /* Store return value in temp so we can emit cleanup before ret */
-        llvm::AllocaInst* retTemp = cg.createEntryAlloca(cg.curFunc, "$retval");
-        cg.B->CreateStore(retVal, retTemp);
+        llvm::AllocaInst* retTemp = cg.createEntryAlloca(cg.curFunc, "$retval", cg.slotType(rk));
+        cg.storeSlot(retVal, retTemp);
         /* Walk ALL scopes from innermost to outermost, emitting cleanup */
         for (int si = (int)cg.localInfoScopes.size() - 1; si >= 0; si--) {
             emitScopeCleanup(cg, cg.localInfoScopes[si]);
             cg.callRT("rt_exit_scope", {});
         }
-        llvm::Value* finalRet = cg.B->CreateLoad(cg.i64Ty, retTemp, "retval");
+        llvm::Value* finalRet = cg.loadSlot(cg.slotType(rk), retTemp, "retval");
         cg.B->CreateRet(finalRet);
         break;
     }
@@ -1213,7 +3327,9 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         /* Try body (setjmp returned 0 — normal path) */
         cg.B->SetInsertPoint(tryBB);
         cg.callRT("rt_try_push", {});  /* increment depth */
+        cg.tryNesting++;
         codegenStmt(cg, node->as.try_catch.try_body);
+        cg.tryNesting--;
         if (!cg.B->GetInsertBlock()->getTerminator()) {
             cg.callRT("rt_try_exit", {});
             cg.B->CreateBr(endBB);
@@ -1225,7 +3341,7 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         if (node->as.try_catch.err_var) {
             llvm::Value* err = cg.callRT("rt_caught_val", {});
             llvm::AllocaInst* errA = cg.createEntryAlloca(F, node->as.try_catch.err_var);
-            cg.B->CreateStore(err, errA);
+            cg.storeSlot(err, errA);
             cg.setLocal(node->as.try_catch.err_var, errA);
         }
         codegenStmt(cg, node->as.try_catch.catch_body);
@@ -1239,27 +3355,103 @@ static void codegenStmt(Codegen& cg, ASTNode* node) {
         llvm::Function* F = cg.curFunc;
         llvm::Value* subject = codegenExpr(cg, node->as.switch_stmt.subject);
         llvm::AllocaInst* swA = cg.createEntryAlloca(F, "$sw");
-        cg.B->CreateStore(subject, swA);
+        cg.storeSlot(subject, swA);
         int n_cases = node->as.switch_stmt.case_count;
         int def_idx = node->as.switch_stmt.default_idx;
+        bool bmode  = node->as.switch_stmt.break_mode;
         llvm::BasicBlock* endBB = llvm::BasicBlock::Create(cg.ctx, "sw.end", F);
-        cg.loopStack.push_back({nullptr, endBB, nullptr});
+
+        /* One body block per non-default case in source order; default last */
+        std::vector<int> order;
+        std::vector<llvm::BasicBlock*> bodyBBs;
         for (int i = 0; i < n_cases; i++) {
             if (i == def_idx) continue;
-            llvm::BasicBlock* caseBB = llvm::BasicBlock::Create(cg.ctx, "sw.case", F);
-            llvm::BasicBlock* nextBB = llvm::BasicBlock::Create(cg.ctx, "sw.next", F);
-            llvm::Value* swVal = cg.B->CreateLoad(cg.i64Ty, swA);
-            llvm::Value* caseVal = codegenExpr(cg, node->as.switch_stmt.case_values[i]);
-            llvm::Value* eq = cg.callRT("rt_eq", {swVal, caseVal});
-            llvm::Value* cond = cg.callRT("rt_is_truthy", {eq});
-            cg.B->CreateCondBr(cg.B->CreateICmpNE(cond, cg.i32Val(0)), caseBB, nextBB);
-            cg.B->SetInsertPoint(caseBB);
-            codegenStmt(cg, node->as.switch_stmt.case_bodies[i]);
+            order.push_back(i);
+            bodyBBs.push_back(llvm::BasicBlock::Create(cg.ctx, "sw.case", F));
+        }
+        llvm::BasicBlock* defBB = def_idx >= 0 ? llvm::BasicBlock::Create(cg.ctx, "sw.default", F) : endBB;
+
+        bool allInt = !order.empty(), allStr = !order.empty();
+        for (int i : order) {
+            int64_t iv;
+            ASTNode* cv = node->as.switch_stmt.case_values[i];
+            if (!switchIntLiteral(cv, &iv)) allInt = false;
+            if (cv->type != NODE_STRING_LIT) allStr = false;
+        }
+
+        if (allInt) {
+            /* Int literals: LLVM switch on the unboxed subject.  Non-int
+             * subjects never compare equal to an int, so they take default. */
+            if (!(cg.mode != MODE_DYNAMIC &&
+                  numericKind(llvm_infer_expr_type(cg, node->as.switch_stmt.subject)) == SLOT_INT)) {
+                llvm::BasicBlock* intBB = llvm::BasicBlock::Create(cg.ctx, "sw.int", F);
+                cg.B->CreateCondBr(cg.B->CreateICmpEQ(cg.B->CreateLShr(subject, 48), cg.i64Val(0xFFFA)), intBB, defBB);
+                cg.B->SetInsertPoint(intBB);
+            }
+            llvm::SwitchInst* sw = cg.B->CreateSwitch(cg.unboxInt(subject), defBB, (unsigned)order.size());
+            std::set<int64_t> seen;
+            for (size_t k = 0; k < order.size(); k++) {
+                int64_t iv;
+                switchIntLiteral(node->as.switch_stmt.case_values[order[k]], &iv);
+                iv = (int64_t)((uint64_t)iv << 16) >> 16;     /* compare as the boxed 48-bit value */
+                if (seen.insert(iv).second) sw->addCase(cg.i64Val(iv), bodyBBs[k]);
+            }
+        } else if (allStr) {
+            /* String literals: switch on the subject's cached hash (0 for
+             * non-strings), then one length+memcmp check per candidate. */
+            std::map<uint32_t, std::vector<size_t>> byHash;
+            std::set<std::string> seen;
+            std::vector<std::string> lits(order.size());
+            for (size_t k = 0; k < order.size(); k++) {
+                ASTNode* cv = node->as.switch_stmt.case_values[order[k]];
+                std::string lit = literalText(cv);
+                if (!seen.insert(lit).second) continue;
+                lits[k] = lit;
+                byHash[hash_string(lit.c_str(), (int)lit.size())].push_back(k);
+            }
+            llvm::Value* h = cg.callRT("rt_string_hash", {subject});
+            llvm::SwitchInst* sw = cg.B->CreateSwitch(h, defBB, (unsigned)byHash.size());
+            for (auto& group : byHash) {
+                llvm::BasicBlock* checkBB = llvm::BasicBlock::Create(cg.ctx, "sw.strcmp", F);
+                sw->addCase(cg.i64Val(group.first), checkBB);
+                cg.B->SetInsertPoint(checkBB);
+                for (size_t gi = 0; gi < group.second.size(); gi++) {
+                    size_t k = group.second[gi];
+                    llvm::BasicBlock* nextBB = (gi + 1 < group.second.size())
+                        ? llvm::BasicBlock::Create(cg.ctx, "sw.strcmp", F) : defBB;
+                    llvm::Value* eq = cg.callRT("rt_string_equals", {subject, cg.makeStringConstant(lits[k]),
+                                                                     cg.i32Val((int)lits[k].size())});
+                    cg.B->CreateCondBr(cg.B->CreateICmpNE(eq, cg.i32Val(0)), bodyBBs[k], nextBB);
+                    if (nextBB != defBB) cg.B->SetInsertPoint(nextBB);
+                }
+            }
+        } else {
+            /* Arbitrary case expressions: compare in order with rt_eq */
+            for (size_t k = 0; k < order.size(); k++) {
+                llvm::BasicBlock* nextBB = llvm::BasicBlock::Create(cg.ctx, "sw.next", F);
+                llvm::Value* swVal = cg.loadSlot(cg.i64Ty, swA);
+                llvm::Value* caseVal = codegenExpr(cg, node->as.switch_stmt.case_values[order[k]]);
+                llvm::Value* eq = cg.callRT("rt_eq", {swVal, caseVal});
+                cg.B->CreateCondBr(cg.unboxBool(eq), bodyBBs[k], nextBB);
+                cg.B->SetInsertPoint(nextBB);
+            }
+            cg.B->CreateBr(defBB);
+        }
+
+        /* Bodies.  With #switchBreakMode true a body falls into the next
+         * one (and finally into default) unless it breaks. */
+        cg.loopStack.push_back({nullptr, endBB, nullptr});
+        for (size_t k = 0; k < order.size(); k++) {
+            cg.B->SetInsertPoint(bodyBBs[k]);
+            codegenStmt(cg, node->as.switch_stmt.case_bodies[order[k]]);
+            llvm::BasicBlock* after = !bmode ? endBB : (k + 1 < order.size() ? bodyBBs[k + 1] : defBB);
+            if (!cg.B->GetInsertBlock()->getTerminator()) cg.B->CreateBr(after);
+        }
+        if (def_idx >= 0) {
+            cg.B->SetInsertPoint(defBB);
+            codegenStmt(cg, node->as.switch_stmt.case_bodies[def_idx]);
             if (!cg.B->GetInsertBlock()->getTerminator()) cg.B->CreateBr(endBB);
-            cg.B->SetInsertPoint(nextBB);
         }
-        if (def_idx >= 0) codegenStmt(cg, node->as.switch_stmt.case_bodies[def_idx]);
-        if (!cg.B->GetInsertBlock()->getTerminator()) cg.B->CreateBr(endBB);
         cg.loopStack.pop_back();
         cg.B->SetInsertPoint(endBB);
         break;
@@ -1352,6 +3544,149 @@ static void codegenProgram(Codegen& cg, ASTNode* program) {
     cg.B->CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(cg.ctx), 0));
 }
 
+/* ══════════════════════════════════════════════════════════════════
+ *  Target CPU selection
+ *  --cpu picks the TargetMachine CPU and which runtime bitcode to link.
+ *  On x86-64 the runtime is embedded once per psABI level (baseline,
+ *  v2, v3, v4); `native` links the highest level the host supports.
+ * ══════════════════════════════════════════════════════════════════ */
+
+struct TargetCPU {
+    std::string cpu = "generic";
+    std::string features;
+    int isa_level = 1;      /* x86-64 psABI level of the runtime bitcode */
+};
+
+/* Highest x86-64 psABI level whose features the host has */
+static int x86LevelOf(const llvm::StringMap<bool>& host) {
+    auto all = [&](std::initializer_list<const char*> names) {
+        for (const char* n : names) {
+            auto it = host.find(n);
+            if (it == host.end() || !it->second) return false;
+        }
+        return true;
+    };
+    if (!all({"cx16", "popcnt", "sahf", "sse3", "sse4.1", "sse4.2", "ssse3"})) return 1;
+    if (!all({"avx", "avx2", "bmi", "bmi2", "f16c", "fma", "lzcnt", "movbe", "xsave"})) return 2;
+    if (!all({"avx512f", "avx512bw", "avx512cd", "avx512dq", "avx512vl"})) return 3;
+    return 4;
+}
+
+static bool selectTargetCPU(const char* name, const llvm::Triple& triple, TargetCPU& out) {
+    if (!name || strcmp(name, "generic") == 0) return true;
+    bool x86 = triple.getArch() == llvm::Triple::x86_64;
+    if (strcmp(name, "native") == 0) {
+        out.cpu = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> host = llvm::sys::getHostCPUFeatures();
+        for (auto& kv : host) {
+            if (!out.features.empty()) out.features += ",";
+            out.features += (kv.second ? "+" : "-") + kv.first().str();
+        }
+        if (x86) out.isa_level = x86LevelOf(host);
+        return true;
+    }
+    static const char* levels[] = { "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4" };
+    for (int i = 0; x86 && i < 4; i++) {
+        if (strcmp(name, levels[i]) == 0) {
+            out.cpu = name;
+            out.isa_level = i + 1;
+            return true;
+        }
+    }
+    fprintf(stderr, "[Tantrums] Unsupported --cpu '%s' for target %s "
+                    "(expected native, x86-64, x86-64-v2, x86-64-v3 or x86-64-v4).\n",
+            name, triple.str().c_str());
+    return false;
+}
+
+static llvm::MemoryBufferRef runtimeBitcodeFor(int isa_level) {
+    auto ref = [](const unsigned char* data, size_t size, const char* name) {
+        return llvm::MemoryBufferRef(llvm::StringRef(reinterpret_cast<const char*>(data), size), name);
+    };
+#ifdef TANTRUMS_RUNTIME_ISA_LEVELS
+    switch (isa_level) {
+    case 2: return ref(tantrums_runtime_bc_v2, tantrums_runtime_bc_v2_size, "tantrums_runtime_v2");
+    case 3: return ref(tantrums_runtime_bc_v3, tantrums_runtime_bc_v3_size, "tantrums_runtime_v3");
+    case 4: return ref(tantrums_runtime_bc_v4, tantrums_runtime_bc_v4_size, "tantrums_runtime_v4");
+    default: break;
+    }
+#else
+    (void)isa_level;
+#endif
+    return ref(tantrums_runtime_bc, tantrums_runtime_bc_size, "tantrums_runtime");
+}
+
+/* ══════════════════════════════════════════════════════════════════
+ *  Optimization levels
+ *  -O sets the level for the build; `#optimize` overrides it for the
+ *  functions of one file.  The module pipeline runs at the highest speed
+ *  level anything asks for.  Functions wanting less are marked optnone
+ *  (O0) or optsize/minsize (Os/Oz).  Between O1..O3 there is no
+ *  per-function control, so those functions get the module's level.
+ * ══════════════════════════════════════════════════════════════════ */
+
+static int optRank(OptLevel l) {
+    switch (l) {
+    case OPT_O0: return 0;
+    case OPT_O1: return 1;
+    case OPT_O3: return 3;
+    default:     return 2;      /* O2, Os, Oz */
+    }
+}
+
+static OptLevel nodeOptLevel(ASTNode* n, OptLevel base) {
+    return n->node_opt >= 0 ? (OptLevel)n->node_opt : base;
+}
+
+static OptLevel moduleOptLevel(ASTNode* program, OptLevel base) {
+    OptLevel level = base;
+    auto raise = [&](OptLevel l) { if (optRank(l) > optRank(level)) level = l; };
+    raise(nodeOptLevel(program, base));     /* __tantrums_init */
+    for (int i = 0; i < program->as.program.count; i++)
+        raise(nodeOptLevel(program->as.program.nodes[i], base));
+    return level;
+}
+
+static llvm::OptimizationLevel llvmOptLevel(OptLevel l) {
+    switch (l) {
+    case OPT_O1: return llvm::OptimizationLevel::O1;
+    case OPT_O3: return llvm::OptimizationLevel::O3;
+    case OPT_OS: return llvm::OptimizationLevel::Os;
+    case OPT_OZ: return llvm::OptimizationLevel::Oz;
+    default:     return llvm::OptimizationLevel::O2;
+    }
+}
+
+/* Attach each generated function's own level as attributes.  Runs before
+ * the runtime is linked, so every definition here is generated code. */
+static void applyOptLevels(Codegen& cg, ASTNode* program, OptLevel base, OptLevel moduleLevel) {
+    std::map<llvm::Function*, OptLevel> levels;
+    for (int i = 0; i < program->as.program.count; i++) {
+        ASTNode* n = program->as.program.nodes[i];
+        if (n->type != NODE_FUNC_DECL) continue;
+        OptLevel l = nodeOptLevel(n, base);
+        auto uf = cg.userFuncs.find(n->as.func_decl.name);
+        if (uf != cg.userFuncs.end()) levels[uf->second] = l;
+        auto sig = cg.funcSigs.find(n->as.func_decl.name);
+        if (sig != cg.funcSigs.end() && sig->second.native) levels[sig->second.native] = l;
+    }
+    /* Top-level statements follow the main file's `#optimize` */
+    if (llvm::Function* init = cg.mod->getFunction("__tantrums_init"))
+        levels[init] = nodeOptLevel(program, base);
+    for (llvm::Function& F : *cg.mod) {
+        if (F.isDeclaration()) continue;
+        auto it = levels.find(&F);
+        OptLevel l = (it != levels.end()) ? it->second : base;
+        if (l == OPT_O0 && moduleLevel != OPT_O0) {
+            F.addFnAttr(llvm::Attribute::OptimizeNone);
+            F.addFnAttr(llvm::Attribute::NoInline);
+        } else if (l == OPT_OS || l == OPT_OZ) {
+            F.addFnAttr(llvm::Attribute::OptimizeForSize);
+            if (l == OPT_OZ) F.addFnAttr(llvm::Attribute::MinSize);
+        }
+    }
+}
+
 /* ══════════════════════════════════════════════════════════════════
  *  Public API
  * ══════════════════════════════════════════════════════════════════ */
@@ -1359,37 +3694,56 @@ static void codegenProgram(Codegen& cg, ASTNode* program) {
 bool llvm_codegen_compile(ASTNode* program, CompileMode mode,
                           const char* source_path,
                           const std::string& outputObj,
-                          bool autofree, bool allow_leaks) {
+                          bool autofree, bool allow_leaks,
+                          const char* cpu, OptLevel opt_level,
+                          bool report_tailcalls) {
     /* Use native target init — InitializeAllTargets doesn't reliably
      * pull in target libraries when linking statically. */
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
     llvm::InitializeNativeTargetAsmParser();
 
+#ifdef TANTRUMS_TARGET_TRIPLE
+    llvm::Triple triple(std::string(TANTRUMS_TARGET_TRIPLE));
+#else
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+#endif
+    TargetCPU tcpu;
+    if (!selectTargetCPU(cpu, triple, tcpu)) return false;
+
     Codegen cg;
     cg.mode = mode;
     cg.autofree_enabled = autofree;
     cg.allow_leaks_enabled = allow_leaks;
+    cg.sourcePath = source_path;
+    cg.reportTailCalls = report_tailcalls;
     cg.mod = std::make_unique<llvm::Module>("tantrums", cg.ctx);
     cg.B = std::make_unique<llvm::IRBuilder<>>(cg.ctx);
     cg.i64Ty   = llvm::Type::getInt64Ty(cg.ctx);
     cg.i32Ty   = llvm::Type::getInt32Ty(cg.ctx);
+    cg.f64Ty   = llvm::Type::getDoubleTy(cg.ctx);
     cg.i8PtrTy = llvm::PointerType::getUnqual(cg.ctx);
     cg.voidTy  = llvm::Type::getVoidTy(cg.ctx);
 
     declareRuntimeFunctions(cg);
     prescan(cg, program);
+    inferFlowTypes(cg, program);
     codegenProgram(cg, program);
+    if (cg.reportTailCalls) {
+        printf("[Tantrums] Tail calls: %d of %d converted\n",
+               cg.tailCallSites - (int)cg.tailCallMisses.size(), cg.tailCallSites);
+        for (const std::string& m : cg.tailCallMisses) printf("  %s\n", m.c_str());
+    }
+
+    OptLevel moduleLevel = moduleOptLevel(program, opt_level);
+    applyOptLevels(cg, program, opt_level, moduleLevel);
 
     /* ══ Link embedded runtime bitcode into user module (Option A LTO) ══
      * This must happen AFTER codegen (so all runtime call sites exist in
      * cg.mod as declared stubs) and BEFORE the optimizer (so the optimizer
      * sees both user IR and runtime definitions simultaneously). */
     {
-        auto bufRef = llvm::MemoryBufferRef(
-            llvm::StringRef(reinterpret_cast<const char*>(tantrums_runtime_bc),
-                            tantrums_runtime_bc_size),
-            "tantrums_runtime");
+        auto bufRef = runtimeBitcodeFor(tcpu.isa_level);
         auto rtModOrErr = llvm::parseBitcodeFile(bufRef, cg.ctx);
         if (!rtModOrErr) {
             fprintf(stderr, "[Tantrums] Failed to parse embedded runtime bitcode.\n");
@@ -1412,11 +3766,6 @@ bool llvm_codegen_compile(ASTNode* program, CompileMode mode,
         return false;
     }
 
-#ifdef TANTRUMS_TARGET_TRIPLE
-    llvm::Triple triple(std::string(TANTRUMS_TARGET_TRIPLE));
-#else
-    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
-#endif
     cg.mod->setTargetTriple(triple);
 
     std::string err;
@@ -1424,22 +3773,47 @@ bool llvm_codegen_compile(ASTNode* program, CompileMode mode,
     if (!target) { fprintf(stderr, "[Tantrums] Target lookup failed: %s\n", err.c_str()); return false; }
 
     llvm::TargetOptions opt;
-    auto TM = target->createTargetMachine(triple, "generic", "", opt, llvm::Reloc::PIC_);
+    auto TM = target->createTargetMachine(triple, tcpu.cpu, tcpu.features, opt, llvm::Reloc::PIC_);
+    if (moduleLevel == OPT_O0)      TM->setOptLevel(llvm::CodeGenOptLevel::None);
+    else if (moduleLevel == OPT_O3) TM->setOptLevel(llvm::CodeGenOptLevel::Aggressive);
     cg.mod->setDataLayout(TM->createDataLayout());
 
-    /* Optimize O2 */
+    /* Generated functions carry no target attributes.  Give them the
+     * selected CPU too, otherwise runtime functions built for a higher
+     * ISA level could not be inlined into them. */
+    if (tcpu.cpu != "generic") {
+        for (llvm::Function& F : *cg.mod) {
+            if (F.isDeclaration() || F.hasFnAttribute("target-cpu")) continue;
+            F.addFnAttr("target-cpu", tcpu.cpu);
+            if (!tcpu.features.empty()) F.addFnAttr("target-features", tcpu.features);
+        }
+    }
+
+    /* Optimize */
     {
         llvm::LoopAnalysisManager LAM;
         llvm::FunctionAnalysisManager FAM;
         llvm::CGSCCAnalysisManager CGAM;
         llvm::ModuleAnalysisManager MAM;
-        llvm::PassBuilder PB(TM);
+        /* The new pass manager only skips optnone functions (#optimize O0)
+         * through the standard instrumentation callbacks */
+        llvm::PassInstrumentationCallbacks PIC;
+        llvm::StandardInstrumentations SI(cg.ctx, false);
+        SI.registerCallbacks(PIC, &MAM);
+        llvm::PassBuilder PB(TM, llvm::PipelineTuningOptions(), std::nullopt, &PIC);
         PB.registerModuleAnalyses(MAM);
         PB.registerCGSCCAnalyses(CGAM);
         PB.registerFunctionAnalyses(FAM);
         PB.registerLoopAnalyses(LAM);
         PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        auto MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+        /* Peephole runs after each InstCombine, so it sees the runtime
+         * helpers once they are inlined */
+        PB.registerPeepholeEPCallback([](llvm::FunctionPassManager& FPM, llvm::OptimizationLevel) {
+            FPM.addPass(NanBoxPass());
+        });
+        llvm::ModulePassManager MPM = (moduleLevel == OPT_O0)
+            ? PB.buildO0DefaultPipeline(llvm::OptimizationLevel::O0)
+            : PB.buildPerModuleDefaultPipeline(llvmOptLevel(moduleLevel));
         MPM.run(*cg.mod, MAM);
     }
 
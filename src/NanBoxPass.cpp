@@ -0,0 +1,359 @@
+/*  NanBoxPass.cpp  —  Remove NaN-box round-trips after runtime inlining
+ *
+ *  Generated code and the inlined runtime pass TantrumsValues around as
+ *  i64 and box/unbox them with the tv_* helpers from runtime.h.  Once
+ *  those helpers are inlined, InstCombine folds the round-trips it can see
+ *  locally, but it gives up on values that flow through PHIs (its known-
+ *  bits walk has a small depth limit and cannot see around loops).  This
+ *  pass tracks two facts optimistically across PHIs and selects:
+ *
+ *    - the tag word (top 16 bits) of an i64, to fold tag tests such as
+ *      `v >> 48 == 0xFFFA` and `v & TV_NAN_BASE`;
+ *    - whether an i64 is already sign-extended from bit 47, to drop the
+ *      `ashr (shl x, 16), 16` that tv_to_int performs.
+ *
+ *  PHIs whose tag is known and whose users only want the payload are
+ *  rebuilt as PHIs of the raw payload, and `tv_to_float(tv_float(d))`
+ *  becomes `d` (the NaN canonicalization only matters for stored boxes).
+ *
+ *  NOTE: like LLVMCodegen.cpp, this file fully qualifies llvm:: names
+ *  because llvm::Value conflicts with the Tantrums Value typedef.
+ */
+#include "NanBoxPass.h"
+#include "runtime.h"
+
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/KnownBits.h>
+
+#include <map>
+#include <vector>
+
+namespace {
+
+const uint64_t PAYLOAD_MASK = 0x0000FFFFFFFFFFFFULL;
+
+/* Optimistic lattice: UNSEEN until some operand is known, then KNOWN,
+ * then VARYING for good.  PHIs start UNSEEN so loop-carried values can
+ * settle on the fact their entry value establishes. */
+enum FactState { UNSEEN, KNOWN, VARYING };
+
+struct TagFact {
+    FactState state = UNSEEN;
+    uint16_t word = 0;
+    bool operator!=(const TagFact& o) const { return state != o.state || word != o.word; }
+};
+
+static TagFact knownTag(uint16_t w) { TagFact t; t.state = KNOWN; t.word = w; return t; }
+static TagFact varyingTag() { TagFact t; t.state = VARYING; return t; }
+
+static TagFact meetTag(TagFact a, TagFact b) {
+    if (a.state == UNSEEN) return b;
+    if (b.state == UNSEEN) return a;
+    if (a.state == KNOWN && b.state == KNOWN && a.word == b.word) return a;
+    return varyingTag();
+}
+
+static FactState meetState(FactState a, FactState b) {
+    if (a == UNSEEN) return b;
+    if (b == UNSEEN) return a;
+    return (a == KNOWN && b == KNOWN) ? KNOWN : VARYING;
+}
+
+static bool isI64(llvm::Value* v) { return v->getType()->isIntegerTy(64); }
+
+static const llvm::ConstantInt* constOp(llvm::Value* v) { return llvm::dyn_cast<llvm::ConstantInt>(v); }
+
+/* `ashr (shl x, 16), 16`: x sign-extended from bit 47 (tv_to_int) */
+static llvm::Value* matchSext48(llvm::Instruction* I) {
+    if (I->getOpcode() != llvm::Instruction::AShr) return nullptr;
+    const llvm::ConstantInt* s = constOp(I->getOperand(1));
+    auto* shl = llvm::dyn_cast<llvm::Instruction>(I->getOperand(0));
+    if (!s || s->getZExtValue() != 16 || !shl || shl->getOpcode() != llvm::Instruction::Shl) return nullptr;
+    const llvm::ConstantInt* t = constOp(shl->getOperand(1));
+    if (!t || t->getZExtValue() != 16) return nullptr;
+    return shl->getOperand(0);
+}
+
+class NanBoxFolder {
+public:
+    NanBoxFolder(llvm::Function& f) : F(f), DL(f.getParent()->getDataLayout()) {}
+
+    bool run() {
+        solve();
+        bool changed = foldTagTests();
+        changed |= foldSext48();
+        changed |= unboxPhiWebs();
+        changed |= foldFloatRoundTrips();
+        return changed;
+    }
+
+private:
+    llvm::Function& F;
+    const llvm::DataLayout& DL;
+    std::map<llvm::Value*, TagFact> tags;
+    std::map<llvm::Value*, FactState> sext;     /* KNOWN = sign-extended from bit 47 */
+    std::map<llvm::Value*, TagFact> localTags;  /* known-bits results, lattice-independent */
+    std::map<llvm::Value*, FactState> localSext;
+    std::map<llvm::Value*, llvm::Value*> raw;   /* tagged value → its payload */
+
+    TagFact tagOf(llvm::Value* v) {
+        if (const llvm::ConstantInt* c = constOp(v)) return knownTag((uint16_t)(c->getZExtValue() >> 48));
+        auto it = tags.find(v);
+        if (it != tags.end()) return it->second;
+        return llvm::isa<llvm::Instruction>(v) ? TagFact() : varyingTag();
+    }
+
+    FactState sextOf(llvm::Value* v) {
+        if (const llvm::ConstantInt* c = constOp(v)) {
+            int64_t n = c->getSExtValue();
+            return (n >= -(1LL << 47) && n < (1LL << 47)) ? KNOWN : VARYING;
+        }
+        auto it = sext.find(v);
+        if (it != sext.end()) return it->second;
+        return llvm::isa<llvm::Instruction>(v) ? UNSEEN : VARYING;
+    }
+
+    TagFact localTag(llvm::Instruction* I) {
+        auto it = localTags.find(I);
+        if (it != localTags.end()) return it->second;
+        llvm::KnownBits kb = llvm::computeKnownBits(I, DL);
+        uint64_t known = (kb.Zero | kb.One).getZExtValue();
+        TagFact t = ((known >> 48) == 0xFFFF) ? knownTag((uint16_t)(kb.One.getZExtValue() >> 48)) : varyingTag();
+        localTags[I] = t;
+        return t;
+    }
+
+    TagFact evalTag(llvm::Instruction* I) {
+        switch (I->getOpcode()) {
+        case llvm::Instruction::PHI: {
+            TagFact t;
+            for (llvm::Value* in : llvm::cast<llvm::PHINode>(I)->incoming_values())
+                if (in != I) t = meetTag(t, tagOf(in));
+            return t;
+        }
+        case llvm::Instruction::Select:
+            return meetTag(tagOf(I->getOperand(1)), tagOf(I->getOperand(2)));
+        case llvm::Instruction::Or: {
+            TagFact a = tagOf(I->getOperand(0)), b = tagOf(I->getOperand(1));
+            if ((a.state == KNOWN && a.word == 0xFFFF) || (b.state == KNOWN && b.word == 0xFFFF)) return knownTag(0xFFFF);
+            if (a.state == UNSEEN || b.state == UNSEEN) return TagFact();
+            if (a.state == KNOWN && b.state == KNOWN) return knownTag(a.word | b.word);
+            return localTag(I);
+        }
+        case llvm::Instruction::And: {
+            TagFact a = tagOf(I->getOperand(0)), b = tagOf(I->getOperand(1));
+            if ((a.state == KNOWN && a.word == 0) || (b.state == KNOWN && b.word == 0)) return knownTag(0);
+            if (a.state == UNSEEN || b.state == UNSEEN) return TagFact();
+            if (a.state == KNOWN && b.state == KNOWN) return knownTag(a.word & b.word);
+            return localTag(I);
+        }
+        default:
+            return localTag(I);
+        }
+    }
+
+    FactState evalSext(llvm::Instruction* I) {
+        if (matchSext48(I)) return KNOWN;
+        if (auto* phi = llvm::dyn_cast<llvm::PHINode>(I)) {
+            FactState s = UNSEEN;
+            for (llvm::Value* in : phi->incoming_values())
+                if (in != I) s = meetState(s, sextOf(in));
+            return s;
+        }
+        if (auto* sel = llvm::dyn_cast<llvm::SelectInst>(I))
+            return meetState(sextOf(sel->getTrueValue()), sextOf(sel->getFalseValue()));
+        auto it = localSext.find(I);
+        if (it != localSext.end()) return it->second;
+        return localSext[I] = llvm::ComputeNumSignBits(I, DL) >= 17 ? KNOWN : VARYING;
+    }
+
+    /* Iterate both lattices to a fixpoint over every i64 instruction */
+    void solve() {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (llvm::BasicBlock& BB : F) {
+                for (llvm::Instruction& I : BB) {
+                    if (!isI64(&I)) continue;
+                    TagFact oldT = tagOf(&I), newT = evalTag(&I);
+                    if (oldT.state == KNOWN && newT.state == KNOWN && oldT.word != newT.word) newT = varyingTag();
+                    if (oldT.state == VARYING) newT = oldT;
+                    if (newT != oldT) { tags[&I] = newT; changed = true; }
+
+                    FactState oldS = sextOf(&I), newS = evalSext(&I);
+                    if (oldS == VARYING || (oldS == KNOWN && newS == UNSEEN)) newS = oldS;
+                    if (newS != oldS) { sext[&I] = newS; changed = true; }
+                }
+            }
+        }
+    }
+
+    bool known(llvm::Value* v, uint16_t* word) {
+        TagFact t = tagOf(v);
+        if (t.state != KNOWN) return false;
+        *word = t.word;
+        return true;
+    }
+
+    /* Replace `I` with constant `c`, then fold any compare that becomes
+     * constant as a result */
+    void replaceWithConstant(llvm::Instruction* I, uint64_t c) {
+        llvm::Constant* k = llvm::ConstantInt::get(I->getType(), c);
+        std::vector<llvm::Instruction*> users;
+        for (llvm::User* u : I->users())
+            if (auto* ui = llvm::dyn_cast<llvm::Instruction>(u)) users.push_back(ui);
+        I->replaceAllUsesWith(k);
+        for (llvm::Instruction* u : users) {
+            if (!llvm::isa<llvm::CmpInst>(u)) continue;
+            if (llvm::Constant* f = llvm::ConstantFoldInstruction(u, DL)) u->replaceAllUsesWith(f);
+        }
+    }
+
+    /* `v >> k` (k >= 48) and `v & mask` (mask within the tag word) on a
+     * value with a known tag word */
+    bool foldTagTests() {
+        std::vector<std::pair<llvm::Instruction*, uint64_t>> folds;
+        for (llvm::BasicBlock& BB : F) {
+            for (llvm::Instruction& I : BB) {
+                if (!isI64(&I) || llvm::isa<llvm::Constant>(I.getOperand(0))) continue;
+                const llvm::ConstantInt* c = I.getNumOperands() == 2 ? constOp(I.getOperand(1)) : nullptr;
+                uint16_t w;
+                if (!c || !known(I.getOperand(0), &w)) continue;
+                uint64_t k = c->getZExtValue();
+                if (I.getOpcode() == llvm::Instruction::LShr && k >= 48 && k < 64)
+                    folds.push_back({&I, (uint64_t)w >> (k - 48)});
+                else if (I.getOpcode() == llvm::Instruction::And && (k & PAYLOAD_MASK) == 0)
+                    folds.push_back({&I, ((uint64_t)w << 48) & k});
+            }
+        }
+        for (auto& f : folds) replaceWithConstant(f.first, f.second);
+        return !folds.empty();
+    }
+
+    bool foldSext48() {
+        std::vector<std::pair<llvm::Instruction*, llvm::Value*>> folds;
+        for (llvm::BasicBlock& BB : F)
+            for (llvm::Instruction& I : BB)
+                if (llvm::Value* x = matchSext48(&I))
+                    if (sextOf(x) == KNOWN) folds.push_back({&I, x});
+        for (auto& f : folds) f.first->replaceAllUsesWith(f.second);
+        return !folds.empty();
+    }
+
+    /* Payload (low 48 bits) of `v`, for a use just before `at`.  Boxes,
+     * constants and PHIs are looked through; anything else is masked. */
+    llvm::Value* rawOf(llvm::Value* v, llvm::Instruction* at) {
+        auto it = raw.find(v);
+        if (it != raw.end()) return it->second;
+        if (const llvm::ConstantInt* c = constOp(v))
+            return llvm::ConstantInt::get(v->getType(), c->getZExtValue() & PAYLOAD_MASK);
+        auto* I = llvm::dyn_cast<llvm::Instruction>(v);
+        if (I && I->getOpcode() == llvm::Instruction::Or) {
+            /* A box: or(x, tag) with x's tag word known zero */
+            for (unsigned i = 0; i < 2; i++) {
+                const llvm::ConstantInt* c = constOp(I->getOperand(1 - i));
+                llvm::Value* x = I->getOperand(i);
+                if (c && (c->getZExtValue() & PAYLOAD_MASK) == 0 &&
+                    llvm::computeKnownBits(x, DL).Zero.getZExtValue() >> 48 == 0xFFFF)
+                    return raw[v] = x;
+            }
+        }
+        if (auto* phi = llvm::dyn_cast_or_null<llvm::PHINode>(I)) {
+            llvm::PHINode* rp = llvm::PHINode::Create(phi->getType(), phi->getNumIncomingValues(),
+                                                      phi->getName() + ".payload", phi);
+            raw[v] = rp;
+            for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+                llvm::BasicBlock* from = phi->getIncomingBlock(i);
+                rp->addIncoming(rawOf(phi->getIncomingValue(i), from->getTerminator()), from);
+            }
+            return rp;
+        }
+        llvm::IRBuilder<> B(at);
+        return B.CreateAnd(v, PAYLOAD_MASK, v->getName() + ".payload");
+    }
+
+    /* A tagged PHI whose users only read its payload (`and v, 0xFFFF...`
+     * or `shl v, >=16`) becomes a PHI of the incoming payloads, so the
+     * boxes feeding it die */
+    bool unboxPhiWebs() {
+        std::vector<llvm::PHINode*> phis;
+        for (llvm::BasicBlock& BB : F)
+            for (llvm::PHINode& phi : BB.phis())
+                if (isI64(&phi) && tagOf(&phi).state == KNOWN) phis.push_back(&phi);
+        bool changed = false;
+        for (llvm::PHINode* phi : phis) {
+            std::vector<llvm::Instruction*> payloadUses;
+            for (llvm::User* u : phi->users()) {
+                auto* ui = llvm::dyn_cast<llvm::Instruction>(u);
+                if (!ui || ui->getOperand(0) != phi) continue;
+                const llvm::ConstantInt* c = ui->getNumOperands() == 2 ? constOp(ui->getOperand(1)) : nullptr;
+                if (!c) continue;
+                if ((ui->getOpcode() == llvm::Instruction::And && c->getZExtValue() == PAYLOAD_MASK) ||
+                    (ui->getOpcode() == llvm::Instruction::Shl && c->getZExtValue() >= 16))
+                    payloadUses.push_back(ui);
+            }
+            if (payloadUses.empty()) continue;
+            llvm::Value* p = rawOf(phi, nullptr);
+            for (llvm::Instruction* u : payloadUses) {
+                if (u->getOpcode() == llvm::Instruction::And) u->replaceAllUsesWith(p);
+                else u->setOperand(0, p);
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+    /* bitcast(select(is-tag-space(b), TV_NAN_BASE, b)) to double, where
+     * b = bitcast(d): the value unboxed is d, up to the NaN payload */
+    bool foldFloatRoundTrips() {
+        std::vector<std::pair<llvm::Instruction*, llvm::Value*>> folds;
+        for (llvm::BasicBlock& BB : F) {
+            for (llvm::Instruction& I : BB) {
+                auto* bc = llvm::dyn_cast<llvm::BitCastInst>(&I);
+                if (!bc || !bc->getType()->isDoubleTy()) continue;
+                auto* sel = llvm::dyn_cast<llvm::SelectInst>(bc->getOperand(0));
+                if (!sel) continue;
+                const llvm::ConstantInt* nan = constOp(sel->getTrueValue());
+                auto* box = llvm::dyn_cast<llvm::BitCastInst>(sel->getFalseValue());
+                if (!nan || nan->getZExtValue() != TV_NAN_BASE || !box || !box->getSrcTy()->isDoubleTy()) continue;
+                if (!isTagSpaceTest(sel->getCondition(), box)) continue;
+                folds.push_back({bc, box->getOperand(0)});
+            }
+        }
+        for (auto& f : folds) f.first->replaceAllUsesWith(f.second);
+        return !folds.empty();
+    }
+
+    /* `(b & TV_NAN_BASE) == TV_NAN_BASE`, or InstCombine's `b u> TV_NAN_BASE - 1` */
+    static bool isTagSpaceTest(llvm::Value* cond, llvm::Value* b) {
+        auto* cmp = llvm::dyn_cast<llvm::ICmpInst>(cond);
+        if (!cmp) return false;
+        const llvm::ConstantInt* k = constOp(cmp->getOperand(1));
+        if (!k) return false;
+        if (cmp->getPredicate() == llvm::ICmpInst::ICMP_UGT && cmp->getOperand(0) == b)
+            return k->getZExtValue() == TV_NAN_BASE - 1;
+        if (cmp->getPredicate() == llvm::ICmpInst::ICMP_UGE && cmp->getOperand(0) == b)
+            return k->getZExtValue() == TV_NAN_BASE;
+        auto* mask = llvm::dyn_cast<llvm::Instruction>(cmp->getOperand(0));
+        if (cmp->getPredicate() != llvm::ICmpInst::ICMP_EQ || k->getZExtValue() != TV_NAN_BASE ||
+            !mask || mask->getOpcode() != llvm::Instruction::And || mask->getOperand(0) != b)
+            return false;
+        const llvm::ConstantInt* m = constOp(mask->getOperand(1));
+        return m && m->getZExtValue() == TV_NAN_BASE;
+    }
+};
+
+} /* namespace */
+
+llvm::PreservedAnalyses NanBoxPass::run(llvm::Function& F, llvm::FunctionAnalysisManager&) {
+    if (F.isDeclaration()) return llvm::PreservedAnalyses::all();
+    if (!NanBoxFolder(F).run()) return llvm::PreservedAnalyses::all();
+    llvm::PreservedAnalyses PA;
+    PA.preserveSet<llvm::CFGAnalyses>();
+    return PA;
+}
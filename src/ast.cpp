@@ -7,6 +7,7 @@ ASTNode* ast_new(NodeType type, int line) {
     node->node_mode        = -1; /* inherit */
     node->node_autofree    = -1; /* inherit */
     node->node_allow_leaks = -1; /* inherit */
+    node->node_opt         = -1; /* inherit */
     return node;
 }
 
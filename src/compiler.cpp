@@ -240,6 +240,8 @@ static bool types_compatible(const char* expected, const char* actual) {
     if (!is_pointer_type(expected) && !is_pointer_type(actual)) {
         if (strcmp(expected, "float") == 0 && strcmp(actual, "int") == 0) return true;
     }
+    /* int[] / float[] convert from lists and from each other */
+    if (strstr(expected, "[]") && (strcmp(actual, "list") == 0 || strstr(actual, "[]"))) return true;
     /* null is compatible with any pointer */
     if (strcmp(actual, "null") == 0 && is_pointer_type(expected)) return true;
     /* pointer types must match exactly — int* is NOT compatible with float* */
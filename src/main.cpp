@@ -7,12 +7,19 @@
  *
  *  Flags (before filename):
  *    --no-autofree-notes   Suppress auto-free notes on stdout
+ *    --cpu=<cpu>           build/run: tune for native, x86-64, x86-64-v2/v3/v4
+ *    --report-tailcalls    build/run: list `return f(...)` calls that could
+ *                          not be made guaranteed tail calls
+ *    -O0 -O1 -O2 -O3 -Os -Oz
+ *                          build/run: optimization level (default -O2);
+ *                          a file's `#optimize O3` overrides it for that file
  */
 #include "compiler.h"
 #include "LLVMCodegen.h"
 #include "lexer.h"
 #include "parser.h"
 #include "bytecode_file.h"
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -91,6 +98,37 @@ static CompileMode strip_mode(char* source) {
     return mode;
 }
 
+/* "O0".."O3", "Os", "Oz" → OptLevel, or -1 */
+static int parse_opt_level(const char* s) {
+    if (s[0] != 'O' || !s[1] || isalnum((unsigned char)s[2])) return -1;
+    switch (s[1]) {
+    case '0': return OPT_O0;
+    case '1': return OPT_O1;
+    case '2': return OPT_O2;
+    case '3': return OPT_O3;
+    case 's': return OPT_OS;
+    case 'z': return OPT_OZ;
+    default:  return -1;
+    }
+}
+
+/* `#optimize <level>` — returns the level, or -1 when absent/unknown */
+static int strip_optimize(char* source) {
+    int level = -1;
+    char* p = source;
+    while ((p = strstr(p, "#optimize"))) {
+        char* after = p + 9;
+        while (*after == ' ' || *after == '\t') after++;
+        int l = parse_opt_level(after);
+        if (l >= 0) level = l;
+        char* end = strchr(p, '\n');
+        if (!end) end = p + strlen(p);
+        memset(p, ' ', end - p);
+        p = end;
+    }
+    return level;
+}
+
 struct MemoryDirectives {
     int autofree;
     int allow_leaks;
@@ -132,6 +170,7 @@ static MemoryDirectives strip_memory_directives(char* source) {
 static ASTNode* prepare_ast(char* source, const char* source_path, CompileMode* out_mode) {
     CompileMode mode = strip_mode(source);
     *out_mode = mode;
+    int opt = strip_optimize(source);
 
     if (mode == MODE_STATIC)
         printf("[Tantrums] Mode: static (all variables must have types)\n");
@@ -156,6 +195,11 @@ static ASTNode* prepare_ast(char* source, const char* source_path, CompileMode*
     ASTNode* ast = parser_parse(&tokens);
     tokenlist_free(&tokens);
     if (!ast) return nullptr;
+    if (ast->type == NODE_PROGRAM) {
+        ast->node_opt = opt;    /* the main file's top-level code */
+        for (int i = 0; i < ast->as.program.count; i++)
+            ast->as.program.nodes[i]->node_opt = opt;
+    }
 
     /* ── Resolve imports ── */
     if (ast->type == NODE_PROGRAM) {
@@ -215,6 +259,7 @@ static ASTNode* prepare_ast(char* source, const char* source_path, CompileMode*
 
             CompileMode imp_mode = strip_mode(imp_src);
             MemoryDirectives imp_mem = strip_memory_directives(imp_src);
+            int imp_opt = strip_optimize(imp_src);
 
             Lexer il;
             lexer_init(&il, imp_src);
@@ -247,6 +292,7 @@ static ASTNode* prepare_ast(char* source, const char* source_path, CompileMode*
                 imp_ast->as.program.nodes[k]->node_mode = (int)imp_mode;
                 imp_ast->as.program.nodes[k]->node_autofree = imp_mem.autofree;
                 imp_ast->as.program.nodes[k]->node_allow_leaks = imp_mem.allow_leaks;
+                imp_ast->as.program.nodes[k]->node_opt = imp_opt;
             }
 
             const char* mode_str = imp_mode == MODE_STATIC ? "static" :
@@ -355,6 +401,11 @@ static void print_usage() {
     printf("  tantrums build <file.42AHH | file.trinitrotoluene>    Compile to native executable\n");
     printf("  tantrums run <file.42AHH | file.trinitrotoluene>      Build + run immediately\n");
     printf("  tantrums compile <file.42AHH | file.trinitrotoluene>  Compile to .42ass bytecode\n");
+    printf("Flags (before the file, build/run):\n");
+    printf("  --no-autofree-notes   Suppress auto-free notes\n");
+    printf("  --cpu=<cpu>           Target CPU: native, x86-64, x86-64-v2, x86-64-v3, x86-64-v4\n");
+    printf("  --report-tailcalls    List return calls not converted to tail calls\n");
+    printf("  -O0 -O1 -O2 -O3 -Os -Oz  Optimization level (default -O2)\n");
 }
 
 /* ── Main ────────────────────────────────────────────── */
@@ -370,12 +421,26 @@ int main(int argc, char* argv[]) {
         bool do_run = (strcmp(argv[1], "run") == 0);
 
         int arg_idx = 2;
-        if (argc > 2 && strcmp(argv[arg_idx], "--no-autofree-notes") == 0) {
-            suppress_autofree_notes = true;
+        const char* cpu = nullptr;
+        OptLevel opt_level = OPT_O2;
+        bool report_tailcalls = false;
+        while (arg_idx < argc && argv[arg_idx][0] == '-') {
+            if (strcmp(argv[arg_idx], "--no-autofree-notes") == 0) {
+                suppress_autofree_notes = true;
+            } else if (strncmp(argv[arg_idx], "--cpu=", 6) == 0) {
+                cpu = argv[arg_idx] + 6;
+            } else if (strcmp(argv[arg_idx], "--report-tailcalls") == 0) {
+                report_tailcalls = true;
+            } else if (parse_opt_level(argv[arg_idx] + 1) >= 0) {
+                opt_level = (OptLevel)parse_opt_level(argv[arg_idx] + 1);
+            } else {
+                fprintf(stderr, "Unknown flag '%s'.\n", argv[arg_idx]);
+                return 1;
+            }
             arg_idx++;
         }
         if (arg_idx >= argc) {
-            fprintf(stderr, "Usage: tantrums %s [--no-autofree-notes] <file.42AHH | file.trinitrotoluene>\n", argv[1]);
+            fprintf(stderr, "Usage: tantrums %s [--no-autofree-notes] [--cpu=<cpu>] [--report-tailcalls] [-O<level>] <file.42AHH | file.trinitrotoluene>\n", argv[1]);
             return 1;
         }
         const char* file_path = argv[arg_idx];
@@ -408,7 +473,8 @@ int main(int argc, char* argv[]) {
         char* exe_path = make_exe_path(file_path);
 
         bool ok = llvm_codegen_compile(ast, mode, file_path, obj_path,
-                                        global_autofree, global_allow_leaks);
+                                        global_autofree, global_allow_leaks, cpu, opt_level,
+                                        report_tailcalls);
         ast_free(ast);
         /* Source buffer can now be freed since AST is gone */
         free(source);
@@ -0,0 +1,257 @@
+#include "numconv.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+/* Exactly representable powers of ten */
+static const double POW10_F[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* ── Formatting ──────────────────────────────────────── */
+
+/* Digits of u written backwards, two at a time, ending at `end`;
+ * returns the first char */
+static char* u64_chars(uint64_t u, char* end) {
+    while (u >= 100) {
+        unsigned r = (unsigned)(u % 100);
+        u /= 100;
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + 2 * r, 2);
+    }
+    if (u >= 10) {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + 2 * u, 2);
+    } else {
+        *--end = (char)('0' + u);
+    }
+    return end;
+}
+
+/* Exactly n digits of u (zero-padded) written backwards ending at `end` */
+static char* u64_chars_fixed(uint64_t u, int n, char* end) {
+    for (; n >= 2; n -= 2) {
+        unsigned r = (unsigned)(u % 100);
+        u /= 100;
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + 2 * r, 2);
+    }
+    if (n) *--end = (char)('0' + u % 10);
+    return end;
+}
+
+static int digit_count(uint64_t u) {
+    int n = 1;
+    for (;;) {
+        if (u < 10) return n;
+        if (u < 100) return n + 1;
+        if (u < 1000) return n + 2;
+        if (u < 10000) return n + 3;
+        u /= 10000;
+        n += 4;
+    }
+}
+
+/* Sized up front so the digits go straight into buf */
+int num_format_int(int64_t v, char* buf) {
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    int n = digit_count(u) + (v < 0);
+    buf[n] = '\0';
+    char* p = u64_chars(u, buf + n);
+    if (v < 0) p[-1] = '-';
+    return n;
+}
+
+/* a (finite, >= 0) times 10^n rounded half-to-even, split into the
+ * integer part and the n fraction digits.  Rounds the exact binary value,
+ * as printf does.  False when the value is outside the fast path
+ * (a >= 2^63, or no 128-bit integers). */
+static bool scaled_round(double a, int n, uint64_t* ip, uint64_t* fp) {
+#ifdef __SIZEOF_INT128__
+    uint64_t bits;
+    memcpy(&bits, &a, sizeof(bits));
+    int be = (int)((bits >> 52) & 0x7FF);
+    uint64_t m = bits & ((1ULL << 52) - 1);
+    if (be == 0x7FF) return false;
+    int e = -1074;
+    if (be != 0) { m |= 1ULL << 52; e = be - 1075; }
+    if (e >= 0) {
+        if (e > 10) return false;
+        *ip = m << e;
+        *fp = 0;
+        return true;
+    }
+    int k = -e;
+    unsigned __int128 prod = (unsigned __int128)m * POW10[n];   /* < 2^87 */
+    unsigned __int128 q = 0;
+    if (k < 128) {
+        q = prod >> k;
+        unsigned __int128 rem = prod - (q << k);
+        unsigned __int128 half = (unsigned __int128)1 << (k - 1);
+        if (rem > half || (rem == half && (q & 1))) q++;
+    }
+    if ((uint64_t)(q >> 64) == 0) {
+        *ip = (uint64_t)q / POW10[n];
+        *fp = (uint64_t)q % POW10[n];
+    } else {
+        *ip = (uint64_t)(q / POW10[n]);
+        *fp = (uint64_t)(q % POW10[n]);
+    }
+    return true;
+#else
+    (void)a; (void)n; (void)ip; (void)fp;
+    return false;
+#endif
+}
+
+/* [-]ip.fp with fp as `n` digits, then trailing zeros cut down to
+ * `keep` fraction digits (the point goes too when keep is 0 and no
+ * fraction digits remain) */
+static int put_decimal(char* buf, bool neg, uint64_t ip, uint64_t fp, int n, int keep) {
+    char tmp[48];
+    char* end = tmp + sizeof(tmp);
+    while (n > keep && fp % 10 == 0) { fp /= 10; n--; }
+    char* p = end;
+    if (n > 0) {
+        p = u64_chars_fixed(fp, n, p);
+        *--p = '.';
+    }
+    p = u64_chars(ip, p);
+    if (neg) *--p = '-';
+    int len = (int)(end - p);
+    memcpy(buf, p, (size_t)len);
+    buf[len] = '\0';
+    return len;
+}
+
+int num_format_print(double d, char* buf) {
+    uint64_t ip, fp;
+    if (scaled_round(std::fabs(d), 10, &ip, &fp))
+        return put_decimal(buf, std::signbit(d), ip, fp, 10, 1);
+    /* Huge or non-finite */
+    snprintf(buf, NUM_BUF_SIZE, "%.10f", d);
+    char* dot = strchr(buf, '.');
+    if (dot) {
+        char* end = buf + strlen(buf) - 1;
+        while (end > dot + 1 && *end == '0') end--;
+        *(end + 1) = '\0';
+    }
+    return (int)strlen(buf);
+}
+
+int num_format_general(double d, char* buf) {
+    /* %g: 6 significant digits; fixed notation when the decimal exponent
+     * X of the rounded value is in [-4, 6), else exponent notation */
+    double a = std::fabs(d);
+    if (a == 0.0) return put_decimal(buf, std::signbit(d), 0, 0, 0, 0);
+    if (a >= 1e-5 && a < 1e6) {
+        /* Guess X, then settle it on the rounded 6-digit value; X = -5 is
+         * only tried to see whether rounding carries up into -4 */
+        static const double LOWER[] = { 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5 };
+        int x = 5;
+        while (x > -5 && a < LOWER[x + 5]) x--;
+        for (;;) {
+            uint64_t ip, fp;
+            int n = 5 - x;
+            if (!scaled_round(a, n, &ip, &fp)) break;
+            uint64_t q = ip * POW10[n] + fp;
+            if (q >= 1000000) { if (x == 5) break; x++; continue; }
+            if (q < 100000)   { if (x == -5) break; x--; continue; }
+            if (x == -5) break;
+            return put_decimal(buf, std::signbit(d), ip, fp, n, 0);
+        }
+    }
+    return snprintf(buf, NUM_BUF_SIZE, "%g", d);
+}
+
+/* ── Parsing ─────────────────────────────────────────── */
+
+static bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+int64_t num_parse_int(const char* s) {
+    while (is_space(*s)) s++;
+    bool neg = false;
+    if (*s == '+' || *s == '-') neg = (*s++ == '-');
+    uint64_t limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    uint64_t u = 0;
+    bool overflow = false;
+    for (; is_digit(*s); s++) {
+        unsigned dgt = (unsigned)(*s - '0');
+        if (u > (limit - dgt) / 10) overflow = true;
+        else u = u * 10 + dgt;
+    }
+    if (overflow) return neg ? INT64_MIN : INT64_MAX;
+    return neg ? (int64_t)(0 - u) : (int64_t)u;
+}
+
+/* Decimal input with at most 19 significant digits whose value is
+ * m * 10^e with m < 2^53 and a small e is converted with one correctly
+ * rounded multiply or divide (Clinger's fast path).  Hex floats, inf/nan,
+ * longer mantissas and extreme exponents are left to strtod. */
+double num_parse_float(const char* s) {
+    const char* p = s;
+    while (is_space(*p)) p++;
+    bool neg = false;
+    if (*p == '+' || *p == '-') neg = (*p++ == '-');
+    if ((p[0] == '0' && (p[1] | 0x20) == 'x') || (*p | 0x20) == 'i' || (*p | 0x20) == 'n')
+        return strtod(s, nullptr);
+
+    uint64_t m = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false, inexact = false;
+    for (; is_digit(*p); p++) {
+        any = true;
+        unsigned dgt = (unsigned)(*p - '0');
+        if (m == 0 && dgt == 0) continue;
+        if (digits < 19) { m = m * 10 + dgt; digits++; }
+        else { exp10++; if (dgt) inexact = true; }
+    }
+    if (*p == '.') {
+        for (p++; is_digit(*p); p++) {
+            any = true;
+            unsigned dgt = (unsigned)(*p - '0');
+            if (m == 0 && dgt == 0) { exp10--; continue; }
+            if (digits < 19) { m = m * 10 + dgt; digits++; exp10--; }
+            else if (dgt) inexact = true;
+        }
+    }
+    if (!any) return 0.0;
+    if ((*p | 0x20) == 'e') {
+        const char* q = p + 1;
+        bool eneg = false;
+        if (*q == '+' || *q == '-') eneg = (*q++ == '-');
+        if (is_digit(*q)) {
+            int ev = 0;
+            for (; is_digit(*q); q++) if (ev < 100000) ev = ev * 10 + (*q - '0');
+            exp10 += eneg ? -ev : ev;
+        }
+    }
+    if (m == 0) return neg ? -0.0 : 0.0;
+    if (!inexact && m <= (1ULL << 53)) {
+        if (exp10 > 22 && exp10 <= 22 + 15 && m <= (1ULL << 53) / POW10[exp10 - 22]) {
+            m *= POW10[exp10 - 22];   /* still exact: 1e22 does the rest */
+            exp10 = 22;
+        }
+        if (exp10 >= -22 && exp10 <= 22) {
+            double r = (double)m;
+            r = exp10 < 0 ? r / POW10_F[-exp10] : r * POW10_F[exp10];
+            return neg ? -r : r;
+        }
+    }
+    return strtod(s, nullptr);
+}
@@ -483,6 +483,21 @@ static bool is_type_token(TokenType t) {
            t == TOKEN_VOID;
 }
 
+/* `[]` right after int/float makes a typed array type ("int[]") */
+static char* array_suffix(Parser* p, Token* type, char* type_name) {
+    if (!check(p, TOKEN_LEFT_BRACKET) || p->tokens->tokens[p->current + 1].type != TOKEN_RIGHT_BRACKET)
+        return type_name;
+    advance_tok(p); advance_tok(p);
+    if (type->type != TOKEN_TYPE_INT && type->type != TOKEN_TYPE_FLOAT) {
+        fprintf(stderr, "[Line %d] Error: Only int[] and float[] arrays can be declared.\n", type->line);
+        p->had_error = true;
+    }
+    char* arr_type = (char*)malloc(strlen(type_name) + 3);
+    sprintf(arr_type, "%s[]", type_name);
+    free(type_name);
+    return arr_type;
+}
+
 static ASTNode* if_statement(Parser* p) {
     ASTNode* n = ast_new(NODE_IF, previous(p)->line);
     consume(p, TOKEN_LEFT_PAREN, "Expected '(' after 'if'.");
@@ -525,7 +540,7 @@ static ASTNode* func_declaration(Parser* p) {
     /* Check for optional return type (e.g., int foo() or int* foo()) */
     if (is_type_token(peek_tok(p)->type)) {
         Token* rt = advance_tok(p);
-        char* type_name = copy_lexeme(rt);
+        char* type_name = array_suffix(p, rt, copy_lexeme(rt));
         if (match(p, TOKEN_STAR)) {
             char* ptr_type = (char*)malloc(strlen(type_name) + 2);
             sprintf(ptr_type, "%s*", type_name);
@@ -547,7 +562,7 @@ static ASTNode* func_declaration(Parser* p) {
             /* Optional type annotation (e.g., int x or int* x) */
             if (is_type_token(peek_tok(p)->type)) {
                 Token* pt = advance_tok(p);
-                char* pt_name = copy_lexeme(pt);
+                char* pt_name = array_suffix(p, pt, copy_lexeme(pt));
                 if (match(p, TOKEN_STAR)) {
                     char* ptr_type = (char*)malloc(strlen(pt_name) + 2);
                     sprintf(ptr_type, "%s*", pt_name);
@@ -748,13 +763,16 @@ static ASTNode* declaration(Parser* p) {
     if (is_type_token(peek_tok(p)->type)) {
         bool is_pointer = false;
         int name_idx = p->current + 1;
+        if (p->tokens->tokens[name_idx].type == TOKEN_LEFT_BRACKET &&
+            p->tokens->tokens[name_idx + 1].type == TOKEN_RIGHT_BRACKET)
+            name_idx += 2;
         if (p->tokens->tokens[name_idx].type == TOKEN_STAR) {
             is_pointer = true;
             name_idx++;
         }
         if (name_idx < p->tokens->count && p->tokens->tokens[name_idx].type == TOKEN_IDENTIFIER) {
             Token* type = advance_tok(p);
-            char* type_name = copy_lexeme(type);
+            char* type_name = array_suffix(p, type, copy_lexeme(type));
             if (is_pointer) {
                 advance_tok(p); /* Skip the * token */
                 char* ptr_type = (char*)malloc(strlen(type_name) + 2);
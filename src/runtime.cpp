@@ -6,6 +6,7 @@
 #include "runtime.h"
 #include "value.h"
 #include "memory.h"
+#include "numconv.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -60,14 +61,12 @@ static double tv_as_number(TantrumsValue v, bool* ok) {
 }
 
 /* Portable value-to-string: no stdout redirection needed.
- * Writes a string representation of a Value into buf. */
+ * Writes a string representation of a Value into buf, which holds at
+ * least NUM_BUF_SIZE bytes. */
 static void value_sprint(Value v, char* buf, size_t buf_size) {
     switch (v.type) {
-    case VAL_INT:   snprintf(buf, buf_size, "%" PRId64, v.as.integer); break;
-    case VAL_FLOAT: {
-        snprintf(buf, buf_size, "%g", v.as.floating);
-        break;
-    }
+    case VAL_INT:   num_format_int(v.as.integer, buf); break;
+    case VAL_FLOAT: num_format_general(v.as.floating, buf); break;
     case VAL_BOOL:  snprintf(buf, buf_size, "%s", v.as.boolean ? "true" : "false"); break;
     case VAL_NULL:  snprintf(buf, buf_size, "null"); break;
     case VAL_OBJ: {
@@ -82,7 +81,19 @@ static void value_sprint(Value v, char* buf, size_t buf_size) {
             for (int i = 0; i < list->count && (size_t)off < buf_size - 2; i++) {
                 if (i > 0) off += snprintf(buf + off, buf_size - off, ", ");
                 char tmp[256];
-                value_sprint(list->items[i], tmp, sizeof(tmp));
+                value_sprint(obj_list_get(list, i), tmp, sizeof(tmp));
+                off += snprintf(buf + off, buf_size - off, "%s", tmp);
+            }
+            snprintf(buf + off, buf_size - off, "]");
+            break;
+        }
+        case OBJ_ARRAY: {
+            ObjArray* arr = (ObjArray*)v.as.obj;
+            int off = snprintf(buf, buf_size, "[");
+            for (int64_t i = 0; i < arr->count && (size_t)off < buf_size - 2; i++) {
+                if (i > 0) off += snprintf(buf + off, buf_size - off, ", ");
+                char tmp[64];
+                value_sprint(obj_array_get(arr, i), tmp, sizeof(tmp));
                 off += snprintf(buf + off, buf_size - off, "%s", tmp);
             }
             snprintf(buf + off, buf_size - off, "]");
@@ -93,8 +104,11 @@ static void value_sprint(Value v, char* buf, size_t buf_size) {
             break;
         case OBJ_RANGE: {
             ObjRange* r = (ObjRange*)v.as.obj;
-            snprintf(buf, buf_size, "range(%" PRId64 ", %" PRId64 ", %" PRId64 ")",
-                     r->start, r->start + r->length * r->step, r->step);
+            char start[NUM_BUF_SIZE], end[NUM_BUF_SIZE], step[NUM_BUF_SIZE];
+            num_format_int(r->start, start);
+            num_format_int(r->start + r->length * r->step, end);
+            num_format_int(r->step, step);
+            snprintf(buf, buf_size, "range(%s, %s, %s)", start, end, step);
             break;
         }
         case OBJ_POINTER: {
@@ -391,6 +405,24 @@ void rt_print(TantrumsValue* args, int32_t count) {
     printf("\n");
 }
 
+void rt_print_str(const char* chars, int32_t length) {
+    fwrite(chars, 1, (size_t)length, stdout);
+}
+
+void rt_print_int(int64_t v) {
+    char buf[NUM_BUF_SIZE];
+    fwrite(buf, 1, (size_t)num_format_int(v, buf), stdout);
+}
+
+void rt_print_f64(double v) {
+    char buf[NUM_BUF_SIZE];
+    fwrite(buf, 1, (size_t)num_format_print(v, buf), stdout);
+}
+
+void rt_print_val(TantrumsValue v) {
+    value_print(tv_to_value(v));
+}
+
 /* ── Strings ────────────────────────────────────────── */
 
 TantrumsValue rt_string_from_cstr(const char* s) {
@@ -398,6 +430,20 @@ TantrumsValue rt_string_from_cstr(const char* s) {
     return tv_obj(str);
 }
 
+/* Cached hash of a string value, 0 (never a real hash) for non-strings */
+int64_t rt_string_hash(TantrumsValue v) {
+    if (tv_tag(v) != TV_TAG_OBJ) return 0;
+    Obj* obj = (Obj*)tv_to_obj(v);
+    if (!obj || obj->type != OBJ_STRING) return 0;
+    return ((ObjString*)obj)->hash;
+}
+
+/* Caller has established v is a string (e.g. via rt_string_hash) */
+int32_t rt_string_equals(TantrumsValue v, const char* chars, int32_t length) {
+    ObjString* s = (ObjString*)tv_to_obj(v);
+    return s->length == length && memcmp(s->chars, chars, length) == 0;
+}
+
 TantrumsValue rt_input(TantrumsValue prompt) {
     int tag = tv_tag(prompt);
     if (tag == TV_TAG_OBJ) {
@@ -426,6 +472,7 @@ TantrumsValue rt_len(TantrumsValue v) {
         case OBJ_LIST:   return tv_int(((ObjList*)obj)->count);
         case OBJ_MAP:    return tv_int(((ObjMap*)obj)->count);
         case OBJ_RANGE:  return tv_int(((ObjRange*)obj)->length);
+        case OBJ_ARRAY:  return tv_int(((ObjArray*)obj)->count);
         default: break;
         }
     }
@@ -471,6 +518,14 @@ TantrumsValue rt_list_new(TantrumsValue* items, int32_t count) {
     return tv_obj(list);
 }
 
+TantrumsValue rt_list_new_local(void* mem, TantrumsValue* items, int32_t count) {
+    ObjList* list = obj_list_new_local(mem, count);
+    for (int i = 0; i < count; i++) {
+        obj_list_append(list, tv_to_value(items[i]));
+    }
+    return tv_obj(list);
+}
+
 TantrumsValue rt_map_new(TantrumsValue* keys, TantrumsValue* vals, int32_t count) {
     ObjMap* map = obj_map_new();
     for (int i = 0; i < count; i++) {
@@ -479,6 +534,40 @@ TantrumsValue rt_map_new(TantrumsValue* keys, TantrumsValue* vals, int32_t count
     return tv_obj(map);
 }
 
+/* Map literal whose keys are all distinct string literals: the shape is
+ * interned on the site's first run and cached in `site` after that. */
+TantrumsValue rt_map_new_shaped(Shape** site, TantrumsValue* keys, TantrumsValue* vals, int32_t count) {
+    Shape* shape = *site;
+    if (!shape) {
+        ObjString** ks = (ObjString**)malloc(sizeof(ObjString*) * count);
+        for (int i = 0; i < count; i++) ks[i] = (ObjString*)tv_to_obj(keys[i]);
+        shape = *site = shape_intern(ks, count);
+        free(ks);
+        if (!shape) return rt_map_new(keys, vals, count);
+    }
+    ObjMap* map = obj_map_new_shaped(shape);
+    for (int i = 0; i < count; i++) map->slots[i] = tv_to_value(vals[i]);
+    return tv_obj(map);
+}
+
+/* `site` is null when the literal's keys can't form a shape */
+TantrumsValue rt_map_new_local(void* mem, Shape** site, TantrumsValue* keys, TantrumsValue* vals, int32_t count) {
+    Shape* shape = site ? *site : nullptr;
+    if (site && !shape) {
+        ObjString** ks = (ObjString**)malloc(sizeof(ObjString*) * count);
+        for (int i = 0; i < count; i++) ks[i] = (ObjString*)tv_to_obj(keys[i]);
+        shape = *site = shape_intern(ks, count);
+        free(ks);
+    }
+    ObjMap* map = obj_map_new_local(mem, shape);
+    if (shape) {
+        for (int i = 0; i < count; i++) map->slots[i] = tv_to_value(vals[i]);
+    } else {
+        for (int i = 0; i < count; i++) obj_map_set(map, tv_to_value(keys[i]), tv_to_value(vals[i]));
+    }
+    return tv_obj(map);
+}
+
 TantrumsValue rt_index_get(TantrumsValue obj_tv, TantrumsValue idx_tv) {
     Value obj = tv_to_value(obj_tv);
     Value idx = tv_to_value(idx_tv);
@@ -502,7 +591,30 @@ TantrumsValue rt_index_get(TantrumsValue obj_tv, TantrumsValue idx_tv) {
             }
             rt_fatal_error("List index %" PRId64 " out of bounds (length %d).", i, list->count);
         }
-        return value_to_tv(list->items[i]);
+        return value_to_tv(obj_list_get(list, (int)i));
+    }
+    if (IS_ARRAY(obj)) {
+        /* Compiled code reads typed arrays inline and only lands here for
+         * dynamic receivers or a failed bounds check */
+        ObjArray* arr = AS_ARRAY(obj);
+        if (!IS_INT(idx)) {
+            if (try_depth > 0) {
+                caught_exception = tv_obj(obj_string_new("Array index must be an integer.", 31));
+                longjmp(try_stack[try_depth - 1], 1);
+            }
+            rt_fatal_error("Array index must be an integer.");
+        }
+        int64_t i = AS_INT(idx);
+        if (i < 0 || i >= arr->count) {
+            if (try_depth > 0) {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "Array index %" PRId64 " out of bounds (length %" PRId64 ").", i, arr->count);
+                caught_exception = tv_obj(obj_string_new(buf, (int)strlen(buf)));
+                longjmp(try_stack[try_depth - 1], 1);
+            }
+            rt_fatal_error("Array index %" PRId64 " out of bounds (length %" PRId64 ").", i, arr->count);
+        }
+        return value_to_tv(obj_array_get(arr, i));
     }
     if (IS_MAP(obj)) {
         ObjMap* map = AS_MAP(obj);
@@ -537,12 +649,63 @@ void rt_index_set(TantrumsValue obj_tv, TantrumsValue idx_tv, TantrumsValue val_
         if (!IS_INT(idx)) return;
         int64_t i = AS_INT(idx);
         if (i < 0 || i >= list->count) return;
-        list->items[i] = val;
+        obj_list_put(list, (int)i, val);
+    } else if (IS_ARRAY(obj)) {
+        ObjArray* arr = AS_ARRAY(obj);
+        if (!IS_INT(idx)) return;
+        int64_t i = AS_INT(idx);
+        if (i < 0 || i >= arr->count) return;
+        obj_array_put(arr, i, val);
     } else if (IS_MAP(obj)) {
         obj_map_set(AS_MAP(obj), idx, val);
     }
 }
 
+/* obj.field / obj["literal"]: key is a static ObjString emitted by the
+ * compiler and its hash is a compile-time constant, so map records are
+ * probed without building or hashing a key.  Shaped maps go through the
+ * site's inline cache; anything but a map takes the generic path. */
+static inline int field_slot(ObjMap* map, ObjString* key, uint32_t hash, RtFieldCache* ic) {
+    if (map->shape != ic->shape) {
+        ic->shape = map->shape;
+        ic->slot = shape_slot(map->shape, key, hash);
+    }
+    return ic->slot;
+}
+
+TantrumsValue rt_field_get(TantrumsValue obj_tv, ObjString* key, int32_t hash, RtFieldCache* ic) {
+    if (tv_tag(obj_tv) == TV_TAG_OBJ) {
+        Obj* obj = (Obj*)tv_to_obj(obj_tv);
+        if (obj && obj->type == OBJ_MAP) {
+            ObjMap* map = (ObjMap*)obj;
+            if (map->shape) {
+                int slot = field_slot(map, key, (uint32_t)hash, ic);
+                return slot >= 0 ? value_to_tv(map->slots[slot]) : TV_NULL;
+            }
+            Value out;
+            if (obj_map_get_str(map, key, (uint32_t)hash, &out)) return value_to_tv(out);
+            return TV_NULL;
+        }
+    }
+    return rt_index_get(obj_tv, tv_obj(key));
+}
+
+void rt_field_set(TantrumsValue obj_tv, ObjString* key, int32_t hash, RtFieldCache* ic, TantrumsValue val_tv) {
+    if (tv_tag(obj_tv) == TV_TAG_OBJ) {
+        Obj* obj = (Obj*)tv_to_obj(obj_tv);
+        if (obj && obj->type == OBJ_MAP) {
+            ObjMap* map = (ObjMap*)obj;
+            if (map->shape) {
+                int slot = field_slot(map, key, (uint32_t)hash, ic);
+                if (slot >= 0) { map->slots[slot] = tv_to_value(val_tv); return; }
+            }
+            obj_map_set_str(map, key, (uint32_t)hash, tv_to_value(val_tv));
+            return;
+        }
+    }
+    rt_index_set(obj_tv, tv_obj(key), val_tv);
+}
+
 void rt_append(TantrumsValue list_tv, TantrumsValue val_tv) {
     Value list = tv_to_value(list_tv);
     Value val = tv_to_value(val_tv);
@@ -553,6 +716,8 @@ void rt_append(TantrumsValue list_tv, TantrumsValue val_tv) {
             p->escaped = true;
         }
         obj_list_append(AS_LIST(list), val);
+    } else if (IS_ARRAY(list)) {
+        obj_array_push(AS_ARRAY(list), val);
     }
 }
 
@@ -574,6 +739,16 @@ TantrumsValue rt_alloc(TantrumsValue init_tv, const char* type_name, int32_t lin
     return tv_obj(ptr);
 }
 
+TantrumsValue rt_alloc_local(void* mem, TantrumsValue init_tv) {
+    ObjPointer* ptr = obj_pointer_new_local(mem);
+    *ptr->target = tv_to_value(init_tv);
+    return tv_obj(ptr);
+}
+
+void rt_local_release(void* mem) {
+    obj_local_release((Obj*)mem);
+}
+
 void rt_free_val(TantrumsValue ptr_tv) {
     if (tv_tag(ptr_tv) == TV_TAG_NULL) {
         if (try_depth > 0) {
@@ -652,22 +827,87 @@ void rt_ptr_set(TantrumsValue ptr_tv, TantrumsValue val_tv) {
 
 /* ── Arithmetic ─────────────────────────────────────── */
 
+/* ── String concatenation ───────────────────────────── */
+
+/* Text of one concatenation part as value_sprint formats it.  Strings are
+ * used in place and scalars are formatted straight into the result;
+ * other objects still go through value_sprint. */
+static bool concat_is_string(Value v) {
+    return v.type == VAL_OBJ && v.as.obj && v.as.obj->type == OBJ_STRING;
+}
+
+static int concat_measure(Value v) {
+    char buf[4096];
+    switch (v.type) {
+    case VAL_INT:   return num_format_int(v.as.integer, buf);
+    case VAL_FLOAT: return num_format_general(v.as.floating, buf);
+    case VAL_BOOL:  return v.as.boolean ? 4 : 5;
+    case VAL_NULL:  return 4;
+    default:
+        if (concat_is_string(v)) return ((ObjString*)v.as.obj)->length;
+        value_sprint(v, buf, sizeof(buf));
+        return (int)strlen(buf);
+    }
+}
+
+/* Writes exactly concat_measure(v) chars (plus, for numbers, a NUL that
+ * the next part or the terminator overwrites) */
+static char* concat_write(char* dst, Value v, int length) {
+    char buf[4096];
+    const char* src = buf;
+    switch (v.type) {
+    case VAL_INT:   return dst + num_format_int(v.as.integer, dst);
+    case VAL_FLOAT: return dst + num_format_general(v.as.floating, dst);
+    case VAL_BOOL:  src = v.as.boolean ? "true" : "false"; break;
+    case VAL_NULL:  src = "null"; break;
+    default:
+        if (concat_is_string(v)) src = ((ObjString*)v.as.obj)->chars;
+        else value_sprint(v, buf, sizeof(buf));
+        break;
+    }
+    memcpy(dst, src, (size_t)length);
+    return dst + length;
+}
+
+/* All parts joined into one new (mutable, like an rt_add result) string:
+ * every part is measured first so the result is allocated once */
+static ObjString* concat_values(const Value* parts, int count) {
+    int lengths[16];
+    int* lens = count <= 16 ? lengths : (int*)malloc(sizeof(int) * count);
+    int64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        lens[i] = concat_measure(parts[i]);
+        total += lens[i];
+    }
+    if (total > INT32_MAX) rt_fatal_error("String too long.");
+
+    ObjString* s = obj_string_alloc((int)total);
+    char* dst = s->chars;
+    for (int i = 0; i < count; i++) dst = concat_write(dst, parts[i], lens[i]);
+    *dst = '\0';
+    s->hash = hash_string(s->chars, s->length);
+
+    if (lens != lengths) free(lens);
+    return s;
+}
+
+TantrumsValue rt_concat(TantrumsValue* parts, int32_t count) {
+    Value vals[16];
+    Value* vs = count <= 16 ? vals : (Value*)malloc(sizeof(Value) * count);
+    for (int i = 0; i < count; i++) vs[i] = tv_to_value(parts[i]);
+    ObjString* result = concat_values(vs, count);
+    if (vs != vals) free(vs);
+    return tv_obj(result);
+}
+
 TantrumsValue rt_add(TantrumsValue a, TantrumsValue b) {
     Value va = tv_to_value(a);
     Value vb = tv_to_value(b);
 
     /* String concatenation: if either side is a string */
     if (IS_STRING(va) || IS_STRING(vb)) {
-        char buf_a[4096], buf_b[4096];
-        value_sprint(va, buf_a, sizeof(buf_a));
-        value_sprint(vb, buf_b, sizeof(buf_b));
-
-        int la = (int)strlen(buf_a);
-        int lb = (int)strlen(buf_b);
-        ObjString* sa = obj_string_new(buf_a, la);
-        ObjString* sb = obj_string_new(buf_b, lb);
-        ObjString* result = obj_string_concat(sa, sb);
-        return tv_obj(result);
+        Value parts[2] = { va, vb };
+        return tv_obj(concat_values(parts, 2));
     }
 
     /* List/range concat */
@@ -675,9 +915,7 @@ TantrumsValue rt_add(TantrumsValue a, TantrumsValue b) {
         ObjList* result = obj_list_new();
         /* Add left side */
         if (IS_LIST(va)) {
-            ObjList* la = AS_LIST(va);
-            for (int i = 0; i < la->count; i++)
-                obj_list_append(result, la->items[i]);
+            obj_list_extend(result, AS_LIST(va));
         } else {
             ObjRange* ra = AS_RANGE(va);
             for (int64_t i = 0; i < ra->length; i++)
@@ -685,9 +923,7 @@ TantrumsValue rt_add(TantrumsValue a, TantrumsValue b) {
         }
         /* Add right side */
         if (IS_LIST(vb)) {
-            ObjList* lb = AS_LIST(vb);
-            for (int i = 0; i < lb->count; i++)
-                obj_list_append(result, lb->items[i]);
+            obj_list_extend(result, AS_LIST(vb));
         } else {
             ObjRange* rb = AS_RANGE(vb);
             for (int64_t i = 0; i < rb->length; i++)
@@ -857,9 +1093,11 @@ int32_t rt_for_in_has_next(TantrumsValue iterable, int64_t idx) {
     Value v = tv_to_value(iterable);
     if (IS_RANGE(v)) return idx < AS_RANGE(v)->length ? 1 : 0;
     if (IS_LIST(v))  return idx < AS_LIST(v)->count ? 1 : 0;
+    if (IS_ARRAY(v)) return idx < AS_ARRAY(v)->count ? 1 : 0;
     if (IS_STRING(v)) return idx < AS_STRING(v)->length ? 1 : 0;
     if (IS_MAP(v)) {
         ObjMap* map = AS_MAP(v);
+        if (map->shape) return idx < map->count ? 1 : 0;
         int64_t seen = 0;
         for (int i = 0; i < map->capacity; i++) {
             if (map->entries[i].occupied) {
@@ -882,7 +1120,12 @@ TantrumsValue rt_for_in_step(TantrumsValue iterable, int64_t* counter) {
     }
     if (IS_LIST(v)) {
         ObjList* list = AS_LIST(v);
-        if (idx < list->count) return value_to_tv(list->items[idx]);
+        if (idx < list->count) return value_to_tv(obj_list_get(list, (int)idx));
+        return TV_NULL;
+    }
+    if (IS_ARRAY(v)) {
+        ObjArray* arr = AS_ARRAY(v);
+        if (idx < arr->count) return value_to_tv(obj_array_get(arr, idx));
         return TV_NULL;
     }
     if (IS_STRING(v)) {
@@ -892,6 +1135,10 @@ TantrumsValue rt_for_in_step(TantrumsValue iterable, int64_t* counter) {
     }
     if (IS_MAP(v)) {
         ObjMap* map = AS_MAP(v);
+        if (map->shape) {
+            if (idx < map->count) return tv_obj(map->shape->keys[map->shape->iter_order[idx]]);
+            return TV_NULL;
+        }
         int64_t seen = 0;
         for (int i = 0; i < map->capacity; i++) {
             if (map->entries[i].occupied) {
@@ -904,6 +1151,47 @@ TantrumsValue rt_for_in_step(TantrumsValue iterable, int64_t* counter) {
     return TV_NULL;
 }
 
+/* Specialized for-in: the iterable kind is decided once before the loop,
+ * then list/string elements are read without re-dispatching. */
+int32_t rt_for_in_kind(TantrumsValue iterable) {
+    if (tv_tag(iterable) != TV_TAG_OBJ) return RT_FOR_IN_GENERIC;
+    Obj* obj = (Obj*)tv_to_obj(iterable);
+    if (obj->type == OBJ_LIST)   return RT_FOR_IN_LIST;
+    if (obj->type == OBJ_STRING) return RT_FOR_IN_STRING;
+    return RT_FOR_IN_GENERIC;
+}
+
+int64_t rt_list_count(TantrumsValue list) {
+    return ((ObjList*)tv_to_obj(list))->count;
+}
+
+TantrumsValue rt_list_item(TantrumsValue list, int64_t idx) {
+    return value_to_tv(obj_list_get((ObjList*)tv_to_obj(list), (int)idx));
+}
+
+void rt_list_store(TantrumsValue list, int64_t idx, TantrumsValue val) {
+    obj_list_put((ObjList*)tv_to_obj(list), (int)idx, tv_to_value(val));
+}
+
+TantrumsValue rt_map_get(TantrumsValue map, TantrumsValue key) {
+    Value out;
+    if (obj_map_get((ObjMap*)tv_to_obj(map), tv_to_value(key), &out)) return value_to_tv(out);
+    return TV_NULL;
+}
+
+void rt_map_set(TantrumsValue map, TantrumsValue key, TantrumsValue val) {
+    obj_map_set((ObjMap*)tv_to_obj(map), tv_to_value(key), tv_to_value(val));
+}
+
+int64_t rt_string_length(TantrumsValue str) {
+    return ((ObjString*)tv_to_obj(str))->length;
+}
+
+TantrumsValue rt_string_char(TantrumsValue str, int64_t idx) {
+    ObjString* s = (ObjString*)tv_to_obj(str);
+    return tv_obj(obj_string_new(s->chars + idx, 1));
+}
+
 /* ── Error handling ─────────────────────────────────── */
 
 void rt_throw(TantrumsValue val) {
@@ -946,7 +1234,7 @@ TantrumsValue rt_caught_val(void) {
 /* ── Type casting ───────────────────────────────────── */
 
 TantrumsValue rt_cast(TantrumsValue v, int32_t target) {
-    /* target: 0=int, 1=float, 2=string, 3=bool */
+    /* target: 0=int, 1=float, 2=string, 3=bool, 4=int[], 5=float[] */
     Value val = tv_to_value(v);
     switch (target) {
     case 0: { /* int */
@@ -954,7 +1242,7 @@ TantrumsValue rt_cast(TantrumsValue v, int32_t target) {
         if (IS_FLOAT(val)) return tv_int((int64_t)AS_FLOAT(val));
         if (IS_BOOL(val)) return tv_int(AS_BOOL(val) ? 1 : 0);
         if (IS_STRING(val)) {
-            int64_t n = strtoll(AS_CSTRING(val), nullptr, 10);
+            int64_t n = num_parse_int(AS_CSTRING(val));
             return tv_int(n);
         }
         return tv_int(0);
@@ -964,7 +1252,7 @@ TantrumsValue rt_cast(TantrumsValue v, int32_t target) {
         if (IS_INT(val)) return tv_float((double)AS_INT(val));
         if (IS_BOOL(val)) return tv_float(AS_BOOL(val) ? 1.0 : 0.0);
         if (IS_STRING(val)) {
-            double d = strtod(AS_CSTRING(val), nullptr);
+            double d = num_parse_float(AS_CSTRING(val));
             return tv_float(d);
         }
         return tv_float(0.0);
@@ -996,6 +1284,40 @@ TantrumsValue rt_cast(TantrumsValue v, int32_t target) {
         }
         return TV_TRUE;
     }
+    case 4:   /* int[]   */
+    case 5: { /* float[] */
+        /* Typed arrays are always a fresh copy of a list (or of an array of
+         * the other element type); null gives an empty array, so an int[]
+         * variable always holds an array of that kind. */
+        bool is_float = (target == 5);
+        if (IS_ARRAY(val) && AS_ARRAY(val)->is_float == is_float) return v;
+        ObjArray* arr;
+        if (IS_NULL(val)) {
+            arr = obj_array_new(is_float, 0);
+        } else if (IS_LIST(val)) {
+            ObjList* list = AS_LIST(val);
+            arr = obj_array_new(is_float, list->count);
+            for (int i = 0; i < list->count; i++) obj_array_push(arr, obj_list_get(list, i));
+        } else if (IS_ARRAY(val)) {
+            ObjArray* src = AS_ARRAY(val);
+            arr = obj_array_new(is_float, src->count);
+            for (int64_t i = 0; i < src->count; i++) obj_array_push(arr, obj_array_get(src, i));
+        } else if (IS_RANGE(val)) {
+            ObjRange* rg = AS_RANGE(val);
+            arr = obj_array_new(is_float, rg->length);
+            for (int64_t i = 0; i < rg->length; i++) obj_array_push(arr, INT_VAL(rg->start + i * rg->step));
+        } else {
+            char buf[128];
+            snprintf(buf, sizeof(buf), "Cannot convert %s to %s.", value_type_name(val), is_float ? "float[]" : "int[]");
+            if (try_depth > 0) {
+                caught_exception = tv_obj(obj_string_new(buf, (int)strlen(buf)));
+                longjmp(try_stack[try_depth - 1], 1);
+            }
+            rt_fatal_error("%s", buf);
+            return TV_NULL; /* unreachable */
+        }
+        return tv_obj(arr);
+    }
     default: return v;
     }
 }
@@ -375,7 +375,7 @@ TantrumsValue rt_filesystem_writelines(TantrumsValue path_tv, TantrumsValue line
     
     ObjList* list = AS_LIST(lines_val);
     for (int i = 0; i < list->count; i++) {
-        Value item = list->items[i];
+        Value item = obj_list_get(list, i);
         if (!IS_STRING(item)) {
             rt_throw(rt_string_from_cstr("filesystem.writelines: list must contain only strings"));
         }
@@ -1,6 +1,7 @@
 #include "value.h"
 #include "chunk.h"
 #include "memory.h"
+#include "numconv.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -75,6 +76,19 @@ ObjString* obj_string_new(const char* chars, int length) {
     return s;
 }
 
+ObjString* obj_string_alloc(int length) {
+    ObjString* s = (ObjString*)allocate_obj(sizeof(ObjString), OBJ_STRING);
+    s->obj.is_manual = true;
+    s->length = length;
+    s->capacity = length;
+    s->is_mutable = true;
+    s->chars = (char*)tantrums_realloc(nullptr, 0, length + 1);
+    s->chars[length] = '\0';
+    s->hash = 0;
+    s->obj.is_manual = false;
+    return s;
+}
+
 ObjString* obj_string_clone_mutable(ObjString* a) {
     ObjString* r = obj_string_new(a->chars, a->length);
     r->is_mutable = true;
@@ -115,37 +129,180 @@ ObjList* obj_list_new(void) {
     ObjList* l = (ObjList*)allocate_obj(sizeof(ObjList), OBJ_LIST);
     l->items = nullptr; l->count = 0; l->capacity = 0;
     l->escaped = false; l->scope_depth = 0; l->auto_manage = false;
+    l->storage = LIST_EMPTY;
+    l->local = false;
+    return l;
+}
+
+ObjList* obj_list_new_local(void* mem, int capacity) {
+    ObjList* l = (ObjList*)mem;
+    l->obj.type = OBJ_LIST; l->obj.refcount = 1;
+    l->obj.is_manual = false; l->obj.is_marked = false; l->obj.next = nullptr;
+    l->items = l + 1; l->count = 0; l->capacity = capacity;
+    l->escaped = false; l->scope_depth = 0; l->auto_manage = false;
+    l->storage = LIST_EMPTY;
+    l->local = true;
     return l;
 }
 
+static ListStorage list_storage_for(Value v) {
+    switch (v.type) {
+    case VAL_INT:   return LIST_INTS;
+    case VAL_FLOAT: return LIST_FLOATS;
+    case VAL_BOOL:  return LIST_BOOLS;
+    default:        return LIST_VALUES;
+    }
+}
+
+static size_t list_bytes(ListStorage storage, int capacity) {
+    switch (storage) {
+    case LIST_EMPTY:  return 0;
+    case LIST_INTS:   return sizeof(int64_t) * capacity;
+    case LIST_FLOATS: return sizeof(double) * capacity;
+    case LIST_BOOLS:  return ((size_t)capacity + 7) / 8;
+    default:          return sizeof(Value) * capacity;
+    }
+}
+
+/* A local list's items stay in its own storage, right behind the header,
+ * until it outgrows them.  An empty list counts its capacity in Values. */
+static bool list_items_inline(ObjList* l) {
+    return l->local && l->items == (void*)(l + 1);
+}
+
+static void list_free_items(ObjList* l) {
+    if (!list_items_inline(l)) tantrums_realloc(l->items, list_bytes(l->storage, l->capacity), 0);
+}
+
+Value obj_list_get(ObjList* l, int i) {
+    switch (l->storage) {
+    case LIST_INTS:   return INT_VAL(((int64_t*)l->items)[i]);
+    case LIST_FLOATS: return FLOAT_VAL(((double*)l->items)[i]);
+    case LIST_BOOLS:  return BOOL_VAL((((uint8_t*)l->items)[i >> 3] >> (i & 7)) & 1);
+    default:          return ((Value*)l->items)[i];
+    }
+}
+
+static void list_store(ObjList* l, int i, Value v) {
+    switch (l->storage) {
+    case LIST_INTS:   ((int64_t*)l->items)[i] = AS_INT(v); break;
+    case LIST_FLOATS: ((double*)l->items)[i] = AS_FLOAT(v); break;
+    case LIST_BOOLS: {
+        uint8_t* bits = (uint8_t*)l->items;
+        uint8_t mask = (uint8_t)(1u << (i & 7));
+        if (AS_BOOL(v)) bits[i >> 3] |= mask;
+        else            bits[i >> 3] &= (uint8_t)~mask;
+    } break;
+    default:          ((Value*)l->items)[i] = v; break;
+    }
+}
+
+/* Make sure v can be stored into l.  An empty list adopts v's storage;
+ * a raw list that v doesn't fit is rewritten as boxed Values. */
+static void list_fit(ObjList* l, Value v) {
+    ListStorage want = list_storage_for(v);
+    if (l->storage == want || l->storage == LIST_VALUES) return;
+    if (l->count == 0) {
+        if (list_items_inline(l)) {
+            size_t bytes = list_bytes(l->storage == LIST_EMPTY ? LIST_VALUES : l->storage, l->capacity);
+            l->capacity = want == LIST_BOOLS ? (int)(bytes * 8) : (int)(bytes / list_bytes(want, 1));
+        } else {
+            tantrums_realloc(l->items, list_bytes(l->storage, l->capacity), 0);
+            l->items = nullptr; l->capacity = 0;
+        }
+        l->storage = want;
+        return;
+    }
+    Value* boxed = (Value*)tantrums_realloc(nullptr, 0, list_bytes(LIST_VALUES, l->capacity));
+    for (int i = 0; i < l->count; i++) boxed[i] = obj_list_get(l, i);
+    list_free_items(l);
+    l->items = boxed;
+    l->storage = LIST_VALUES;
+}
+
+static void list_reserve(ObjList* l, int need) {
+    if (need <= l->capacity) return;
+    int cap = l->capacity < 8 ? 8 : l->capacity * 2;
+    if (cap < need) cap = need;
+    size_t have = list_bytes(l->storage, l->capacity), bytes = list_bytes(l->storage, cap);
+    if (list_items_inline(l)) {
+        void* heap = tantrums_realloc(nullptr, 0, bytes);
+        memcpy(heap, l->items, have);
+        l->items = heap;
+    } else {
+        l->items = tantrums_realloc(l->items, have, bytes);
+    }
+    l->capacity = cap;
+}
+
 ObjList* obj_list_clone(ObjList* origin) {
     ObjList* l = obj_list_new();
     l->obj.is_manual = true;
-    for (int i = 0; i < origin->count; i++) {
-        obj_list_append(l, origin->items[i]);
-    }
+    obj_list_extend(l, origin);
     l->obj.is_manual = false;
     return l;
 }
 
 void obj_list_append(ObjList* l, Value v) {
-    if (l->count >= l->capacity) {
-        int cap = l->capacity < 8 ? 8 : l->capacity * 2;
-        l->items = (Value*)realloc(l->items, sizeof(Value) * cap);
-        l->capacity = cap;
-    }
-    l->items[l->count++] = v;
+    list_fit(l, v);
+    list_reserve(l, l->count + 1);
+    list_store(l, l->count++, v);
     value_incref(v);
 }
 
+/* Raw int/float storage is copied wholesale when both lists agree */
+void obj_list_extend(ObjList* l, ObjList* src) {
+    if (src->count == 0) return;
+    if ((src->storage == LIST_INTS || src->storage == LIST_FLOATS) &&
+        (l->storage == src->storage || l->storage == LIST_EMPTY)) {
+        list_fit(l, obj_list_get(src, 0));
+        list_reserve(l, l->count + src->count);
+        memcpy((char*)l->items + list_bytes(l->storage, l->count), src->items,
+               list_bytes(src->storage, src->count));
+        l->count += src->count;
+        return;
+    }
+    for (int i = 0; i < src->count; i++) obj_list_append(l, obj_list_get(src, i));
+}
+
+/* Overwrites an element in place; like list assignment, refcounts are
+ * left to the caller */
+void obj_list_put(ObjList* l, int i, Value v) {
+    list_fit(l, v);
+    list_store(l, i, v);
+}
+
 /* ── Map ──────────────────────────────────────────── */
 ObjMap* obj_map_new(void) {
     ObjMap* m = (ObjMap*)allocate_obj(sizeof(ObjMap), OBJ_MAP);
     m->entries = nullptr; m->count = 0; m->capacity = 0;
     m->escaped = false; m->scope_depth = 0; m->auto_manage = false;
+    m->shape = nullptr; m->slots = nullptr;
+    m->local = false;
     return m;
 }
 
+ObjMap* obj_map_new_local(void* mem, Shape* shape) {
+    ObjMap* m = (ObjMap*)mem;
+    m->obj.type = OBJ_MAP; m->obj.refcount = 1;
+    m->obj.is_manual = false; m->obj.is_marked = false; m->obj.next = nullptr;
+    m->entries = nullptr; m->count = 0; m->capacity = 0;
+    m->escaped = false; m->scope_depth = 0; m->auto_manage = false;
+    m->shape = shape; m->slots = nullptr;
+    m->local = true;
+    if (shape) {
+        m->slots = (Value*)(m + 1);
+        for (int i = 0; i < shape->count; i++) m->slots[i] = NULL_VAL;
+        m->count = shape->count;
+    }
+    return m;
+}
+
+/* A local map's shape slots live in its own storage, behind the header */
+static void map_free_slots(ObjMap* m, Value* slots) {
+    if (!(m->local && slots == (Value*)(m + 1))) free(slots);
+}
+
 uint32_t value_hash(Value v) {
     switch (v.type) {
         case VAL_NULL:  return 1;
@@ -189,7 +346,79 @@ static void map_grow(ObjMap* m) {
     free(old);
 }
 
+/* ── Shapes ───────────────────────────────────────── */
+static Shape* all_shapes = nullptr;
+
+static bool same_key(ObjString* a, ObjString* b) {
+    return a == b || (a->hash == b->hash && a->length == b->length &&
+                      memcmp(a->chars, b->chars, a->length) == 0);
+}
+
+/* Shared descriptor for a literal key list, or null if a key repeats
+ * (such a literal is an ordinary hashed map).  Keys must be immortal. */
+Shape* shape_intern(ObjString** keys, int count) {
+    for (Shape* s = all_shapes; s; s = s->next) {
+        if (s->count != count) continue;
+        int i = 0;
+        while (i < count && same_key(s->keys[i], keys[i])) i++;
+        if (i == count) return s;
+    }
+    for (int i = 0; i < count; i++)
+        for (int j = 0; j < i; j++)
+            if (same_key(keys[i], keys[j])) return nullptr;
+
+    Shape* s = (Shape*)malloc(sizeof(Shape));
+    s->count = count;
+    s->keys = (ObjString**)malloc(sizeof(ObjString*) * count);
+    memcpy(s->keys, keys, sizeof(ObjString*) * count);
+    /* Iterate like the hashed table the literal would have built */
+    ObjMap tmp = {};
+    for (int i = 0; i < count; i++) obj_map_set(&tmp, OBJ_VAL(keys[i]), INT_VAL(i));
+    s->iter_order = (int*)malloc(sizeof(int) * count);
+    for (int i = 0, n = 0; i < tmp.capacity; i++)
+        if (tmp.entries[i].occupied) s->iter_order[n++] = (int)AS_INT(tmp.entries[i].value);
+    free(tmp.entries);
+    s->next = all_shapes;
+    all_shapes = s;
+    return s;
+}
+
+int shape_slot(Shape* shape, ObjString* key, uint32_t hash) {
+    for (int i = 0; i < shape->count; i++) {
+        ObjString* k = shape->keys[i];
+        if (k == key || (k->hash == hash && k->length == key->length &&
+                         memcmp(k->chars, key->chars, key->length) == 0))
+            return i;
+    }
+    return -1;
+}
+
+/* Values are left for the caller to fill in */
+ObjMap* obj_map_new_shaped(Shape* shape) {
+    ObjMap* m = obj_map_new();
+    m->shape = shape;
+    m->slots = (Value*)calloc(shape->count, sizeof(Value));
+    m->count = shape->count;
+    return m;
+}
+
+/* Keys diverged from the shape: rebuild the hashed table by inserting in
+ * literal order, which reproduces the layout the literal would have had. */
+static void map_unshape(ObjMap* m) {
+    Shape* shape = m->shape;
+    Value* slots = m->slots;
+    m->shape = nullptr; m->slots = nullptr;
+    m->count = 0;
+    for (int i = 0; i < shape->count; i++) obj_map_set(m, OBJ_VAL(shape->keys[i]), slots[i]);
+    map_free_slots(m, slots);
+}
+
 bool obj_map_set(ObjMap* m, Value key, Value value) {
+    if (m->shape) {
+        int slot = IS_STRING(key) ? shape_slot(m->shape, AS_STRING(key), AS_STRING(key)->hash) : -1;
+        if (slot >= 0) { m->slots[slot] = value; return false; }
+        map_unshape(m);
+    }
     if (m->count + 1 > m->capacity * 0.75) map_grow(m);
     uint32_t idx = value_hash(key) & (m->capacity - 1);
     for (;;) {
@@ -209,6 +438,13 @@ bool obj_map_set(ObjMap* m, Value key, Value value) {
 
 bool obj_map_get(ObjMap* m, Value key, Value* out) {
     if (m->count == 0) return false;
+    if (m->shape) {
+        if (!IS_STRING(key)) return false;
+        int slot = shape_slot(m->shape, AS_STRING(key), AS_STRING(key)->hash);
+        if (slot < 0) return false;
+        *out = m->slots[slot];
+        return true;
+    }
     uint32_t idx = value_hash(key) & (m->capacity - 1);
     for (;;) {
         MapEntry* e = &m->entries[idx];
@@ -220,6 +456,52 @@ bool obj_map_get(ObjMap* m, Value key, Value* out) {
     }
 }
 
+/* String-key probe with the hash supplied by the caller (obj.field access,
+ * hash folded at compile time).  Returns the matching or the first empty slot. */
+static MapEntry* map_find_str(ObjMap* m, ObjString* key, uint32_t hash) {
+    uint32_t idx = hash & (m->capacity - 1);
+    for (;;) {
+        MapEntry* e = &m->entries[idx];
+        if (!e->occupied) return e;
+        if (IS_STRING(e->key)) {
+            ObjString* k = AS_STRING(e->key);
+            if (k == key || (k->hash == hash && k->length == key->length &&
+                             memcmp(k->chars, key->chars, key->length) == 0))
+                return e;
+        }
+        idx = (idx + 1) & (m->capacity - 1);
+    }
+}
+
+bool obj_map_get_str(ObjMap* m, ObjString* key, uint32_t hash, Value* out) {
+    if (m->count == 0) return false;
+    if (m->shape) {
+        int slot = shape_slot(m->shape, key, hash);
+        if (slot < 0) return false;
+        *out = m->slots[slot];
+        return true;
+    }
+    MapEntry* e = map_find_str(m, key, hash);
+    if (!e->occupied) return false;
+    *out = e->value;
+    return true;
+}
+
+bool obj_map_set_str(ObjMap* m, ObjString* key, uint32_t hash, Value value) {
+    if (m->shape) {
+        int slot = shape_slot(m->shape, key, hash);
+        if (slot >= 0) { m->slots[slot] = value; return false; }
+        map_unshape(m);
+    }
+    if (m->count + 1 > m->capacity * 0.75) map_grow(m);
+    MapEntry* e = map_find_str(m, key, hash);
+    e->value = value;
+    if (e->occupied) return false;
+    e->key = OBJ_VAL(key); e->occupied = true;
+    m->count++;
+    return true;
+}
+
 /* ── Function / Native / Pointer ──────────────────── */
 ObjFunction* obj_function_new(void) {
     ObjFunction* f = (ObjFunction*)allocate_obj(sizeof(ObjFunction), OBJ_FUNCTION);
@@ -250,6 +532,39 @@ ObjPointer* obj_pointer_new(Value* target) {
     return p;
 }
 
+ObjPointer* obj_pointer_new_local(void* mem) {
+    ObjPointer* p = (ObjPointer*)mem;
+    p->obj.type = OBJ_POINTER; p->obj.refcount = 1;
+    p->obj.is_manual = false; p->obj.is_marked = false; p->obj.next = nullptr;
+    p->target = (Value*)(p + 1);
+    p->is_valid = true;
+    p->alloc_size = 0;
+    p->alloc_line = 0;
+    p->alloc_type = nullptr;
+    p->alloc_func = nullptr;
+    p->scope_depth = 0;
+    p->escaped = false;
+    p->auto_manage = false;
+    return p;
+}
+
+/* Only what a local object moved to the heap needs freeing */
+void obj_local_release(Obj* obj) {
+    switch (obj->type) {
+    case OBJ_LIST:
+        list_free_items((ObjList*)obj);
+        break;
+    case OBJ_MAP: {
+        ObjMap* map = (ObjMap*)obj;
+        if (map->shape) map_free_slots(map, map->slots);
+        free(map->entries);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
 ObjRange* obj_range_new(int64_t start, int64_t end, int64_t step) {
     ObjRange* r = (ObjRange*)allocate_obj(sizeof(ObjRange), OBJ_RANGE);
     r->start = start;
@@ -267,6 +582,50 @@ ObjRange* obj_range_new(int64_t start, int64_t end, int64_t step) {
     return r;
 }
 
+/* ── Typed array ──────────────────────────────────── */
+ObjArray* obj_array_new(bool is_float, int64_t capacity) {
+    ObjArray* a = (ObjArray*)allocate_obj(sizeof(ObjArray), OBJ_ARRAY);
+    a->is_float = is_float;
+    a->count = 0;
+    a->capacity = capacity;
+    a->data = capacity > 0 ? tantrums_realloc(nullptr, 0, 8 * (size_t)capacity) : nullptr;
+    return a;
+}
+
+/* Elements are stored converted exactly like an int/float cast: floats
+ * truncate into int[], bools become 0/1, strings are parsed, anything
+ * else stores as 0 */
+void obj_array_put(ObjArray* a, int64_t i, Value v) {
+    if (a->is_float) {
+        double d = 0.0;
+        if (IS_FLOAT(v))       d = AS_FLOAT(v);
+        else if (IS_INT(v))    d = (double)AS_INT(v);
+        else if (IS_BOOL(v))   d = AS_BOOL(v) ? 1.0 : 0.0;
+        else if (IS_STRING(v)) d = num_parse_float(AS_CSTRING(v));
+        ((double*)a->data)[i] = d;
+    } else {
+        int64_t n = 0;
+        if (IS_INT(v))         n = AS_INT(v);
+        else if (IS_FLOAT(v))  n = (int64_t)AS_FLOAT(v);
+        else if (IS_BOOL(v))   n = AS_BOOL(v) ? 1 : 0;
+        else if (IS_STRING(v)) n = num_parse_int(AS_CSTRING(v));
+        ((int64_t*)a->data)[i] = n;
+    }
+}
+
+void obj_array_push(ObjArray* a, Value v) {
+    if (a->count >= a->capacity) {
+        int64_t cap = a->capacity < 8 ? 8 : a->capacity * 2;
+        a->data = tantrums_realloc(a->data, 8 * (size_t)a->capacity, 8 * (size_t)cap);
+        a->capacity = cap;
+    }
+    obj_array_put(a, a->count++, v);
+}
+
+Value obj_array_get(ObjArray* a, int64_t i) {
+    return a->is_float ? FLOAT_VAL(((double*)a->data)[i]) : INT_VAL(((int64_t*)a->data)[i]);
+}
+
 /* ── Ref counting ─────────────────────────────────── */
 void value_incref(Value v) {
     if (!IS_OBJ(v) || !AS_OBJ(v)) return;
@@ -311,15 +670,21 @@ void obj_free(Obj* obj) {
     }
     case OBJ_LIST: {
         ObjList* lst = (ObjList*)obj;
-        for (int i = 0; i < lst->count; i++) {
-             value_decref(lst->items[i]);
+        if (lst->storage == LIST_VALUES) {
+            for (int i = 0; i < lst->count; i++) {
+                 value_decref(((Value*)lst->items)[i]);
+            }
         }
-        tantrums_realloc(lst->items, sizeof(Value) * lst->capacity, 0);
+        list_free_items(lst);
         tantrums_realloc(obj, sizeof(ObjList), 0);
         break;
     }
     case OBJ_MAP: {
         ObjMap* map = (ObjMap*)obj;
+        if (map->shape) {
+            for (int i = 0; i < map->shape->count; i++) value_decref(map->slots[i]);
+            map_free_slots(map, map->slots);
+        }
         for (int i = 0; i < map->capacity; i++) {
              MapEntry* e = &map->entries[i];
              if (!IS_NULL(e->key) || !IS_NULL(e->value)) {
@@ -335,6 +700,12 @@ void obj_free(Obj* obj) {
         tantrums_realloc(obj, sizeof(ObjRange), 0);
         break;
     }
+    case OBJ_ARRAY: {
+        ObjArray* a = (ObjArray*)obj;
+        if (a->data) tantrums_realloc(a->data, 8 * (size_t)a->capacity, 0);
+        tantrums_realloc(obj, sizeof(ObjArray), 0);
+        break;
+    }
     }
 }
 
@@ -346,21 +717,10 @@ double value_as_number(Value v) {
 }
 
 void value_print(Value v) {
+    char buf[NUM_BUF_SIZE];
     switch (v.type) {
-    case VAL_INT:   printf("%lld", (long long)AS_INT(v)); break;
-    case VAL_FLOAT: {
-        double d = AS_FLOAT(v);
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%.10f", d);
-        /* Strip trailing zeros after decimal point */
-        char* dot = strchr(buf, '.');
-        if (dot) {
-            char* end = buf + strlen(buf) - 1;
-            while (end > dot + 1 && *end == '0') end--;
-            *(end + 1) = '\0';
-        }
-        printf("%s", buf);
-    } break;
+    case VAL_INT:   fwrite(buf, 1, (size_t)num_format_int(AS_INT(v), buf), stdout); break;
+    case VAL_FLOAT: fwrite(buf, 1, (size_t)num_format_print(AS_FLOAT(v), buf), stdout); break;
     case VAL_BOOL:  printf(AS_BOOL(v) ? "true" : "false"); break;
     case VAL_NULL:  printf("null"); break;
     case VAL_OBJ:
@@ -371,7 +731,7 @@ void value_print(Value v) {
             printf("[");
             for (int i = 0; i < l->count; i++) {
                 if (i > 0) printf(", ");
-                value_print(l->items[i]);
+                value_print(obj_list_get(l, i));
             }
             printf("]");
         } break;
@@ -384,7 +744,16 @@ void value_print(Value v) {
             printf("[");
             for (int64_t i = 0; i < r->length; i++) {
                 if (i > 0) printf(", ");
-                printf("%lld", (long long)(r->start + i * r->step));
+                fwrite(buf, 1, (size_t)num_format_int(r->start + i * r->step, buf), stdout);
+            }
+            printf("]");
+        } break;
+        case OBJ_ARRAY: {
+            ObjArray* a = AS_ARRAY(v);
+            printf("[");
+            for (int64_t i = 0; i < a->count; i++) {
+                if (i > 0) printf(", ");
+                value_print(obj_array_get(a, i));
             }
             printf("]");
         } break;
@@ -430,6 +799,7 @@ const char* value_type_name(Value v) {
         case OBJ_NATIVE:   return "native";
         case OBJ_POINTER:  return "pointer";
         case OBJ_RANGE:    return "range";
+        case OBJ_ARRAY:    return ((ObjArray*)AS_OBJ(v))->is_float ? "float[]" : "int[]";
         }
     }
     return "unknown";